@@ -1,4 +1,5 @@
 #include <iostream>
+#include <vector>
 #include "MyProtoClient.h"
 #include "muduo/net/EventLoop.h"
 
@@ -8,7 +9,11 @@ MyProtoClient::MyProtoClient(EventLoop* loop, const muduo::net::InetAddress& ser
       serverAddr_(serverAddr),
       connectionHandler_(new ConnectionHandler()),
       reconnectIntervalMs_(3000),
-      autoReconnect_(true) {
+      autoReconnect_(true),
+      nextCallId_(1),
+      alive_(std::make_shared<bool>(true)),
+      connected_(false),
+      drainScheduled_(false) {
     
     std::cout << "[Client] Constructor: Creating connectionHandler_" << std::endl;
     
@@ -24,20 +29,26 @@ MyProtoClient::MyProtoClient(EventLoop* loop, const muduo::net::InetAddress& ser
         std::bind(&ConnectionHandler::onConnection, connectionHandler_, std::placeholders::_1)
     );
     
+    // 消息先经过客户端匹配异步调用的响应，再交给用户回调
+    connectionHandler_->setMessageCallback(
+        std::bind(&MyProtoClient::onMessage, this, std::placeholders::_1, std::placeholders::_2)
+    );
+    
     std::cout << "[Client] Setting TcpClient message callback" << std::endl;
     client_.setMessageCallback(
         std::bind(&ConnectionHandler::onMessage, connectionHandler_, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3)
     );
     
-    // 保存定时器ID
-    timerId_ = loop->runEvery(0.5, std::bind(&MyProtoClient::onTimeout, this));
+    // 可靠消息管理器的重传时间轮由客户端所在的loop驱动，不再定期轮询
+    connectionHandler_->initLoop(loop);
+    
+    // 重连后恢复会话，断开期间没有确认的消息自动重放，不需要业务层重发
+    connectionHandler_->enableSessionResumption(true);
 }
 
 // 修改析构函数中的TimerId处理
 MyProtoClient::~MyProtoClient() {
-    // 先取消定时器
-    client_.getLoop()->cancel(timerId_);
-    // 直接调用cancel，不进行比较运算
+    // 先取消重连定时器
     client_.getLoop()->cancel(reconnectTimerId_);
     // 再断开连接
     stop();
@@ -68,6 +79,15 @@ void MyProtoClient::handleConnectionClosed(const TcpConnectionPtr& conn) {
     std::cout << "[Client] handleConnectionClosed called, connection name: " 
               << conn->name() << ", connected: " << (conn->connected() ? "yes" : "no") << std::endl;
     
+    // 发布连接状态，其他线程提交消息前据此判断是否已连接
+    connected_.store(conn->connected() && ConnectionHandler::getContext(conn) != nullptr, std::memory_order_release);
+    
+    // 自动重连时会话会恢复，服务端重放还没确认的响应，进行中的调用继续等待（仍受各自的超时限制）；
+    // 不重连就不会再收到响应，立即结束，不必等到超时
+    if (!conn->connected() && !autoReconnect_) {
+        failAllCalls(RPC_CONNECTION_CLOSED);
+    }
+    
     // 只在连接断开时处理
     if (!conn->connected() && autoReconnect_ && !client_.connection()) {
         std::cout << "[Client] Connection closed, scheduling reconnection in " 
@@ -83,8 +103,12 @@ void MyProtoClient::handleConnectionClosed(const TcpConnectionPtr& conn) {
         );
     } else if (conn->connected()) {
         std::cout << "[Client] Connection established, no need for reconnection" << std::endl;
-    } else if (!autoReconnect_) {
-        std::cout << "[Client] Auto-reconnect is disabled" << std::endl;
+    } else {
+        // 不会重连，断开时保留的会话用不上，立即清理，还没确认的消息通知投递失败
+        connectionHandler_->releaseClientSession();
+        if (!autoReconnect_) {
+            std::cout << "[Client] Auto-reconnect is disabled" << std::endl;
+        }
     }
 }
 
@@ -98,29 +122,204 @@ void MyProtoClient::stop() {
     });
 }
 
-uint32_t MyProtoClient::sendMessage(const MyProtoMsg& msg) {
-    if (!isConnected()) {
-        std::cout << "Warning: Attempting to send message while not connected!" << std::endl;
-        // 如果启用了自动重连但当前未连接，先尝试立即重连
-        if (autoReconnect_) {
-            connect();
+uint32_t MyProtoClient::sendMessage(const MyProtoMsg& msg, const DeliveryAckedCallback& onAcked,
+                                    const DeliveryFailedCallback& onFailed) {
+    // 未连接时直接返回0，不打印、不触发重连（重连由自动重连定时器负责）
+    if (!connected_.load(std::memory_order_acquire)) {
+        return 0;
+    }
+    
+    const MyProtoMsg* out = &msg;
+    MyProtoMsg encoded;
+    // 消息未指定编码时使用该服务的默认编码；编码表整体替换发布，读取方拿到的快照不会再被修改
+    std::shared_ptr<const CodecMap> codecs = std::atomic_load(&serviceCodecs_);
+    if (codecs && msg.head.codec == MY_PROTO_CODEC_JSON) {
+        auto codecIt = codecs->find(msg.head.server);
+        if (codecIt != codecs->end()) {
+            encoded = msg;
+            encoded.head.codec = codecIt->second;
+            out = &encoded;
         }
+    }
+    
+    EventLoop* loop = client_.getLoop();
+    if (loop->isInLoopThread()) {
+        return connectionHandler_->sendMessage(client_.connection(), *out, onAcked, onFailed);
+    }
+    
+    // 其他线程：消息体在本线程序列化，loop取出后才分配序列号、编码协议头并发送
+    SubmittedMessage submitted;
+    if (!ReliableMsgManager::prepareBody(*out, submitted.msg)) {
         return 0;
     }
+    uint32_t ticket = ReliableMsgManager::allocateTicket();
+    submitted.callbacks = ReliableMsgManager::ticketCallbacks(ticket, onAcked, onFailed);
+    submissions_.push(std::move(submitted));
+    
+    // 只有第一个发现loop没有被安排的提交者唤醒loop，同一批的其他提交不再唤醒
+    if (!drainScheduled_.exchange(true, std::memory_order_acq_rel)) {
+        scheduleDrain(loop);
+    }
+    return ticket;
+}
+
+// 客户端可能在回调执行前被销毁，回调先确认客户端还在再取队列
+void MyProtoClient::scheduleDrain(EventLoop* loop) {
+    std::weak_ptr<bool> alive = alive_;
+    loop->queueInLoop([this, alive]() {
+        if (alive.lock()) {
+            drainSubmissions();
+        }
+    });
+}
+
+void MyProtoClient::drainSubmissions() {
+    // 先清除标志再取队列：之后的提交会重新唤醒loop，之前的提交一定能在下面取到
+    drainScheduled_.exchange(false, std::memory_order_acq_rel);
+    
+    TcpConnectionPtr conn = client_.connection();
+    ConnectionContext* ctx = conn && conn->connected() ? ConnectionHandler::getContext(conn) : nullptr;
+    if (ctx) {
+        ctx->reliableManager->beginBatch(conn);
+    }
+    SubmittedMessage submitted;
+    size_t count = 0;
+    while (count < SUBMIT_BATCH_LIMIT && submissions_.pop(submitted)) {
+        count++;
+        // 序列号在这里按取出的顺序分配，没能发出的消息不占用序列号
+        uint32_t sent = 0;
+        if (ctx) {
+            sent = ctx->reliableManager->sendReliableMessage(conn, *ctx->reliable, submitted.msg, submitted.callbacks);
+        }
+        if (sent == 0 && submitted.callbacks && submitted.callbacks->onFailed) {
+            submitted.callbacks->onFailed(0, ctx ? DELIVERY_QUEUE_FULL : DELIVERY_CONNECTION_CLOSED);
+        }
+    }
+    // 整批帧在这里一次写出
+    if (ctx) {
+        ctx->reliableManager->endBatch();
+    }
     
-    uint32_t seq = connectionHandler_->sendMessage(client_.connection(), msg);
-    if (seq > 0) {
-        std::cout << "Sent message with sequence: " << seq << std::endl;
+    if (count == SUBMIT_BATCH_LIMIT && !submissions_.empty() && !drainScheduled_.exchange(true, std::memory_order_acq_rel)) {
+        scheduleDrain(client_.getLoop());
     }
-    return seq;
 }
 
 void MyProtoClient::setMessageCallback(const MessageCallback& cb) {
     messageCallback_ = cb;
-    connectionHandler_->setMessageCallback(cb); // 设置到连接处理器
 }
 
+uint32_t MyProtoClient::asyncCall(uint16_t serverId, const json& body, int timeoutMs, const RpcCallback& cb) {
+    MyProtoMsg request;
+    request.head.version = 1;
+    request.head.server = serverId;
+    request.head.type = 0; // 数据消息
+    request.body = body;
+    return asyncCall(request, timeoutMs, cb);
+}
+
+// 关联ID在调用线程分配并立即返回，登记和发送都转交loop线程，进行中的调用表不需要加锁
+uint32_t MyProtoClient::asyncCall(const MyProtoMsg& request, int timeoutMs, const RpcCallback& cb) {
+    uint32_t callId = nextCallId_.fetch_add(1, std::memory_order_relaxed);
+    if (callId == 0) {
+        callId = nextCallId_.fetch_add(1, std::memory_order_relaxed); // 回绕后跳过0
+    }
+    MyProtoMsg msg = request;
+    setCorrelation(msg.head, callId);
+    client_.getLoop()->runInLoop(std::bind(&MyProtoClient::startCall, this, callId, msg, timeoutMs, cb));
+    return callId;
+}
+
+void MyProtoClient::startCall(uint32_t callId, const MyProtoMsg& request, int timeoutMs, const RpcCallback& cb) {
+    if (!client_.connection() || !client_.connection()->connected()) {
+        if (cb) {
+            cb(RPC_CONNECTION_CLOSED, std::shared_ptr<MyProtoMsg>());
+        }
+        return;
+    }
+    
+    // 先登记再发送，响应不会早于登记到达
+    PendingCall& call = pendingCalls_[callId];
+    call.callback = cb;
+    std::weak_ptr<bool> alive = alive_;
+    if (timeoutMs > 0) {
+        call.hasTimer = true;
+        call.timer = client_.getLoop()->runAfter(timeoutMs / 1000.0, [this, alive, callId]() {
+            if (alive.lock()) {
+                completeCall(callId, RPC_TIMEOUT, std::shared_ptr<MyProtoMsg>());
+            }
+        });
+    }
+    
+    // 请求放弃投递时调用立即失败，不必等到超时
+    uint32_t ticket = sendMessage(request, DeliveryAckedCallback(), [this, alive, callId](uint32_t, DeliveryFailure reason) {
+        if (alive.lock()) {
+            completeCall(callId, reason == DELIVERY_CONNECTION_CLOSED ? RPC_CONNECTION_CLOSED : RPC_SEND_FAILED,
+                         std::shared_ptr<MyProtoMsg>());
+        }
+    });
+    if (ticket == 0) {
+        completeCall(callId, RPC_SEND_FAILED, std::shared_ptr<MyProtoMsg>());
+    }
+}
+
+bool MyProtoClient::completeCall(uint32_t callId, RpcStatus status, const std::shared_ptr<MyProtoMsg>& response) {
+    auto it = pendingCalls_.find(callId);
+    if (it == pendingCalls_.end()) {
+        return false;
+    }
+    RpcCallback callback;
+    callback.swap(it->second.callback);
+    if (it->second.hasTimer && status != RPC_TIMEOUT) {
+        client_.getLoop()->cancel(it->second.timer);
+    }
+    pendingCalls_.erase(it);
+    
+    if (callback) {
+        try {
+            callback(status, response);
+        } catch (const std::exception& e) {
+            std::cerr << "[Client] RPC callback exception, call id: " << callId << ", " << e.what() << std::endl;
+        }
+    }
+    return true;
+}
+
+void MyProtoClient::failAllCalls(RpcStatus status) {
+    std::vector<uint32_t> callIds;
+    callIds.reserve(pendingCalls_.size());
+    for (const auto& call : pendingCalls_) {
+        callIds.push_back(call.first);
+    }
+    for (uint32_t callId : callIds) {
+        completeCall(callId, status, std::shared_ptr<MyProtoMsg>());
+    }
+}
+
+// 客户端没有启用业务线程池，消息回调在loop线程中执行，与调用表的其他访问在同一线程
+void MyProtoClient::onMessage(const TcpConnectionPtr& conn, std::shared_ptr<MyProtoMsg> msg) {
+    if ((msg->head.flags & MY_PROTO_FLAG_CORRELATION) && completeCall(msg->head.correlation, RPC_OK, msg)) {
+        return;
+    }
+    if (messageCallback_) {
+        messageCallback_(conn, msg);
+    }
+}
+
+
+
+// 复制一份修改后整体替换，发送方读取的快照不受影响；设置很少发生，复制的开销可以忽略
+void MyProtoClient::setServiceCodec(uint16_t serverId, MyProtoBodyCodec codec) {
+    std::lock_guard<std::mutex> lock(codecMutex_);
+    std::shared_ptr<const CodecMap> current = std::atomic_load(&serviceCodecs_);
+    std::shared_ptr<CodecMap> codecs = current ? std::make_shared<CodecMap>(*current) : std::make_shared<CodecMap>();
+    (*codecs)[serverId] = codec;
+    std::atomic_store(&serviceCodecs_, std::shared_ptr<const CodecMap>(codecs));
+}
 
+void MyProtoClient::setLazyBody(bool lazy) {
+    connectionHandler_->setLazyBody(lazy);
+}
 
 void MyProtoClient::setReconnectInterval(int intervalMs) {
     reconnectIntervalMs_ = intervalMs;
@@ -128,8 +327,4 @@ void MyProtoClient::setReconnectInterval(int intervalMs) {
 
 void MyProtoClient::enableAutoReconnect(bool enable) {
     autoReconnect_ = enable;
-}
-
-void MyProtoClient::onTimeout() {
-    connectionHandler_->checkTimeoutMessages();
 }
\ No newline at end of file
@@ -1,16 +1,30 @@
 #ifndef __MY_PROTO_CLIENT_H
 #define __MY_PROTO_CLIENT_H
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include "muduo/net/TcpClient.h"
 #include "muduo/net/TimerId.h" // 添加TimerId头文件
 #include "ConnectionHandler.h"
+#include "MpscQueue.h"
+
+typedef enum RpcStatus //异步调用的结果
+{
+	RPC_OK = 0, //收到响应
+	RPC_TIMEOUT = 1, //超时仍未收到响应
+	RPC_SEND_FAILED = 2, //请求没能送达（发送失败或重传用完仍未确认）
+	RPC_CONNECTION_CLOSED = 3, //未连接或收到响应前连接断开
+}RpcStatus;
 
 class MyProtoClient {
 public:
     using EventLoop = muduo::net::EventLoop;
     using TcpConnectionPtr = muduo::net::TcpConnectionPtr;
     using MessageCallback = ConnectionHandler::MessageCallback;
+    // 异步调用完成回调，status为RPC_OK时response为响应消息，否则为空
+    using RpcCallback = std::function<void(RpcStatus status, const std::shared_ptr<MyProtoMsg>& response)>;
     
     MyProtoClient(EventLoop* loop, const muduo::net::InetAddress& serverAddr, const std::string& nameArg);
     ~MyProtoClient();
@@ -19,12 +33,30 @@ public:
     void disconnect();
     void stop();
     
-    // 发送消息
-    uint32_t sendMessage(const MyProtoMsg& msg);
+    // 发送消息，onAcked/onFailed可选，在客户端的loop线程中报告投递结果（见ConnectionHandler::sendMessage）
+    // 返回提交编号，未连接时返回0且不回调；不论在哪个线程调用，回调的第一个参数都是返回的提交编号
+    // 任意线程可调用：其他线程在本线程序列化消息体后放入无锁提交队列，loop被唤醒一次后整批取出，
+    // 按取出顺序分配序列号，合并成一次写发送；提交路径不查询连接、不打印日志，也不获取IO线程的锁
+    uint32_t sendMessage(const MyProtoMsg& msg,
+                         const DeliveryAckedCallback& onAcked = DeliveryAckedCallback(),
+                         const DeliveryFailedCallback& onFailed = DeliveryFailedCallback());
+    
+    // 异步调用：请求带上关联ID发出，收到带回同一关联ID的响应时调用cb，多个调用可以在一条连接上同时进行、乱序完成
+    // timeoutMs<=0表示不限时；任意线程可调用，返回调用ID（即关联ID）
+    // cb在客户端的loop线程中执行且只执行一次；客户端析构时还没完成的调用不再回调
+    uint32_t asyncCall(uint16_t serverId, const json& body, int timeoutMs, const RpcCallback& cb);
+    // 以完整消息发起异步调用（可以指定消息体编码等），消息头中的关联ID由客户端分配
+    uint32_t asyncCall(const MyProtoMsg& request, int timeoutMs, const RpcCallback& cb);
     
-    // 设置消息回调
+    // 设置消息回调，异步调用的响应不会再交给它（超时后才到的响应除外）
     void setMessageCallback(const MessageCallback& cb);
     
+    // 设置某个服务默认使用的消息体编码，未设置的服务使用JSON
+    void setServiceCodec(uint16_t serverId, MyProtoBodyCodec codec);
+    
+    // 设置消息体懒解析（需在connect之前调用）
+    void setLazyBody(bool lazy);
+    
     // 获取连接状态
     bool isConnected() const;
     
@@ -33,21 +65,53 @@ public:
     void enableAutoReconnect(bool enable);
 
 private:
-    // 定时器回调函数
-    void onTimeout();
-    
     // 处理连接断开的方法
     // 修改方法声明
     void handleConnectionClosed(const TcpConnectionPtr& conn);
     
+    // 进行中的异步调用，只在loop线程中访问
+    struct PendingCall {
+        RpcCallback callback;
+        muduo::net::TimerId timer; // 超时定时器
+        bool hasTimer = false;
+    };
+    // 在loop线程中登记调用、设置超时定时器并发出请求
+    void startCall(uint32_t callId, const MyProtoMsg& request, int timeoutMs, const RpcCallback& cb);
+    // 完成调用并回调，调用已经完成过时返回false
+    bool completeCall(uint32_t callId, RpcStatus status, const std::shared_ptr<MyProtoMsg>& response);
+    // 连接断开时结束所有进行中的调用
+    void failAllCalls(RpcStatus status);
+    
+    // 其他线程提交的消息，消息体已经序列化（见ReliableMsgManager::prepareBody），序列号在loop取出时分配
+    struct SubmittedMessage {
+        MyProtoMsg msg;
+        DeliveryCallbacksPtr callbacks; // 按提交编号包装的投递结果回调
+    };
+    typedef std::unordered_map<uint16_t, uint8_t> CodecMap; // 服务ID -> 默认消息体编码
+    // loop每次最多取出的提交数，剩下的在下一轮处理，避免长时间占住loop
+    static const size_t SUBMIT_BATCH_LIMIT = 1024;
+    // 在loop线程中取出提交队列中的消息，整批发送
+    void drainSubmissions();
+    // 安排loop执行drainSubmissions，回调通过alive_确认客户端还存在
+    void scheduleDrain(EventLoop* loop);
+    // 收到的消息先匹配进行中的调用，匹配不到的交给用户的消息回调
+    void onMessage(const TcpConnectionPtr& conn, std::shared_ptr<MyProtoMsg> msg);
+    
     muduo::net::TcpClient client_;
     muduo::net::InetAddress serverAddr_; // 添加服务器地址成员变量
     std::shared_ptr<ConnectionHandler> connectionHandler_;
     MessageCallback messageCallback_;
-    muduo::net::TimerId timerId_; // 定时器ID
     muduo::net::TimerId reconnectTimerId_; // 重连定时器ID
     int reconnectIntervalMs_; // 重连间隔（毫秒）
     bool autoReconnect_; // 是否启用自动重连
+    std::shared_ptr<const CodecMap> serviceCodecs_; // 各服务的默认消息体编码，修改时整体替换；跨线程读写，用std::atomic_load/atomic_store访问
+    std::mutex codecMutex_; // 串行化setServiceCodec的读-改-写
+    std::atomic<uint32_t> nextCallId_; // 下一个异步调用的关联ID
+    std::unordered_map<uint32_t, PendingCall> pendingCalls_; // 关联ID -> 进行中的调用
+    std::shared_ptr<bool> alive_; // 定时器和投递回调通过weak_ptr判断客户端是否还存在
+    std::atomic<bool> connected_; // 是否已连接，其他线程提交消息前检查
+    MpscQueue<SubmittedMessage> submissions_; // 其他线程提交的消息
+    std::atomic<bool> drainScheduled_; // 已经安排loop取出提交队列，期间的提交不再唤醒loop
 };
 
 #endif // __MY_PROTO_CLIENT_H
\ No newline at end of file
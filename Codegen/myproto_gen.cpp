@@ -0,0 +1,421 @@
+// MyProto结构体消息代码生成器
+//
+// 用法: myproto_gen <input.schema> <output.h>
+//
+// schema语法（#开头为注释）：
+//   message TelemetryReport = 2 {   // 消息名 = 服务号
+//       uint32 deviceId;
+//       double temperature;
+//       string location;
+//   }
+// 支持的字段类型：bool int8 int16 int32 int64 uint8 uint16 uint32 uint64 float double string
+//
+// 每个message生成一个C++结构体，包含constexpr字段偏移量、直接读写消息体字节的encode/decode，
+// 以及JSON兼容用的toJson/fromJson。线路格式见Myproto/MyProtoStruct.h。
+#include <stdint.h>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+using namespace std;
+
+namespace {
+
+struct FieldType {
+    string cppType; // 生成的结构体中的成员类型
+    size_t size;    // 在定长区中占用的字节数（string为长度前缀）
+    bool variable;  // 是否有变长内容
+};
+
+const map<string, FieldType>& fieldTypes() {
+    static map<string, FieldType> types;
+    if (types.empty()) {
+        types["bool"] = FieldType{"bool", 1, false};
+        types["int8"] = FieldType{"int8_t", 1, false};
+        types["int16"] = FieldType{"int16_t", 2, false};
+        types["int32"] = FieldType{"int32_t", 4, false};
+        types["int64"] = FieldType{"int64_t", 8, false};
+        types["uint8"] = FieldType{"uint8_t", 1, false};
+        types["uint16"] = FieldType{"uint16_t", 2, false};
+        types["uint32"] = FieldType{"uint32_t", 4, false};
+        types["uint64"] = FieldType{"uint64_t", 8, false};
+        types["float"] = FieldType{"float", 4, false};
+        types["double"] = FieldType{"double", 8, false};
+        types["string"] = FieldType{"std::string", 4, true};
+    }
+    return types;
+}
+
+struct Field {
+    string type;
+    string name;
+    size_t offset;
+};
+
+struct Message {
+    string name;
+    uint16_t serverId;
+    vector<Field> fields;
+    size_t fixedSize;
+    uint32_t schemaId;
+};
+
+// 词法分析：标识符/数字为一个token，{ } = ; 各为一个token
+class Lexer {
+public:
+    explicit Lexer(const string& text) : text_(text), pos_(0), line_(1) {}
+
+    bool next(string& token) {
+        skipSpaceAndComments();
+        if (pos_ >= text_.size()) {
+            return false;
+        }
+        char c = text_[pos_];
+        if (c == '{' || c == '}' || c == '=' || c == ';') {
+            token.assign(1, c);
+            pos_++;
+            return true;
+        }
+        if (!isalnum(static_cast<unsigned char>(c)) && c != '_') {
+            fail(string("unexpected character '") + c + "'");
+        }
+        size_t start = pos_;
+        while (pos_ < text_.size() && (isalnum(static_cast<unsigned char>(text_[pos_])) || text_[pos_] == '_')) {
+            pos_++;
+        }
+        token = text_.substr(start, pos_ - start);
+        return true;
+    }
+
+    string expect(const char* what) {
+        string token;
+        if (!next(token)) {
+            fail(string("unexpected end of file, expected ") + what);
+        }
+        return token;
+    }
+
+    void fail(const string& msg) const {
+        ostringstream oss;
+        oss << "line " << line_ << ": " << msg;
+        throw runtime_error(oss.str());
+    }
+
+private:
+    void skipSpaceAndComments() {
+        while (pos_ < text_.size()) {
+            char c = text_[pos_];
+            if (c == '\n') {
+                line_++;
+                pos_++;
+            } else if (isspace(static_cast<unsigned char>(c))) {
+                pos_++;
+            } else if (c == '#' || (c == '/' && pos_ + 1 < text_.size() && text_[pos_ + 1] == '/')) {
+                while (pos_ < text_.size() && text_[pos_] != '\n') {
+                    pos_++;
+                }
+            } else {
+                break;
+            }
+        }
+    }
+
+    const string& text_;
+    size_t pos_;
+    int line_;
+};
+
+bool isIdentifier(const string& s) {
+    if (s.empty() || isdigit(static_cast<unsigned char>(s[0]))) {
+        return false;
+    }
+    for (size_t i = 0; i < s.size(); i++) {
+        if (!isalnum(static_cast<unsigned char>(s[i])) && s[i] != '_') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// FNV-1a，对规范化后的结构定义取指纹
+uint32_t fnv1a(const string& s) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < s.size(); i++) {
+        h ^= static_cast<uint8_t>(s[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+vector<Message> parseSchema(const string& text) {
+    vector<Message> messages;
+    set<string> names;
+    set<uint16_t> serverIds;
+    Lexer lex(text);
+    string token;
+    while (lex.next(token)) {
+        if (token != "message") {
+            lex.fail("expected 'message', got '" + token + "'");
+        }
+        Message msg;
+        msg.name = lex.expect("message name");
+        if (!isIdentifier(msg.name) || !names.insert(msg.name).second) {
+            lex.fail("invalid or duplicate message name '" + msg.name + "'");
+        }
+        if (lex.expect("'='") != "=") {
+            lex.fail("expected '=' after message name");
+        }
+        string id = lex.expect("server id");
+        unsigned long serverId = strtoul(id.c_str(), NULL, 10);
+        if (id.find_first_not_of("0123456789") != string::npos || serverId > 0xFFFF) {
+            lex.fail("invalid server id '" + id + "'");
+        }
+        msg.serverId = static_cast<uint16_t>(serverId);
+        if (!serverIds.insert(msg.serverId).second) {
+            lex.fail("duplicate server id " + id);
+        }
+        if (lex.expect("'{'") != "{") {
+            lex.fail("expected '{'");
+        }
+
+        set<string> fieldNames;
+        size_t offset = 4; // schema指纹之后
+        string canonical = msg.name + "=" + id + "{";
+        for (;;) {
+            string type = lex.expect("field type or '}'");
+            if (type == "}") {
+                break;
+            }
+            if (fieldTypes().find(type) == fieldTypes().end()) {
+                lex.fail("unknown field type '" + type + "'");
+            }
+            Field field;
+            field.type = type;
+            field.name = lex.expect("field name");
+            if (!isIdentifier(field.name) || !fieldNames.insert(field.name).second) {
+                lex.fail("invalid or duplicate field name '" + field.name + "'");
+            }
+            if (lex.expect("';'") != ";") {
+                lex.fail("expected ';' after field " + field.name);
+            }
+            field.offset = offset;
+            offset += fieldTypes().at(type).size;
+            msg.fields.push_back(field);
+            canonical += type + " " + field.name + ";";
+        }
+        msg.fixedSize = offset;
+        msg.schemaId = fnv1a(canonical + "}");
+        messages.push_back(msg);
+    }
+    return messages;
+}
+
+string offsetName(const string& field) {
+    string name = "kOffset" + field;
+    name[7] = static_cast<char>(toupper(static_cast<unsigned char>(name[7])));
+    return name;
+}
+
+void generateMessage(ostream& out, const Message& msg) {
+    const map<string, FieldType>& types = fieldTypes();
+    char schemaId[16];
+    snprintf(schemaId, sizeof(schemaId), "0x%08Xu", msg.schemaId);
+
+    out << "// " << msg.name << "，服务号" << msg.serverId << "\n";
+    out << "struct " << msg.name << " {\n";
+    out << "    static constexpr const char* kName = \"" << msg.name << "\";\n";
+    out << "    static constexpr uint16_t kServerId = " << msg.serverId << ";\n";
+    out << "    static constexpr uint32_t kSchemaId = " << schemaId << ";\n";
+    for (size_t i = 0; i < msg.fields.size(); i++) {
+        const Field& f = msg.fields[i];
+        out << "    static constexpr size_t " << offsetName(f.name) << " = " << f.offset << "; // " << f.type
+            << (types.at(f.type).variable ? "（长度）" : "") << "\n";
+    }
+    out << "    static constexpr size_t kFixedSize = " << msg.fixedSize << ";\n\n";
+
+    for (size_t i = 0; i < msg.fields.size(); i++) {
+        const Field& f = msg.fields[i];
+        const FieldType& t = types.at(f.type);
+        out << "    " << t.cppType << " " << f.name;
+        if (!t.variable) {
+            out << (f.type == "bool" ? " = false" : " = 0");
+        }
+        out << ";\n";
+    }
+    if (!msg.fields.empty()) {
+        out << "\n";
+    }
+
+    // encodedSize
+    out << "    size_t encodedSize() const {\n";
+    out << "        return kFixedSize";
+    for (size_t i = 0; i < msg.fields.size(); i++) {
+        if (types.at(msg.fields[i].type).variable) {
+            out << " + " << msg.fields[i].name << ".size()";
+        }
+    }
+    out << ";\n    }\n\n";
+
+    // encode
+    out << "    // 直接把消息体写到Buffer末尾；字符串超过MY_PROTO_MAX_JSON_STRING_LEN时不写入，返回false（与decode的限制一致）\n";
+    out << "    bool encode(muduo::net::Buffer* buf) const {\n";
+    for (size_t i = 0; i < msg.fields.size(); i++) {
+        const Field& f = msg.fields[i];
+        if (types.at(f.type).variable) {
+            out << "        if (" << f.name << ".size() > MY_PROTO_MAX_JSON_STRING_LEN) {\n";
+            out << "            return false;\n";
+            out << "        }\n";
+        }
+    }
+    out << "        const size_t size = encodedSize();\n";
+    out << "        buf->ensureWritableBytes(size);\n";
+    out << "        uint8_t* p = reinterpret_cast<uint8_t*>(buf->beginWrite());\n";
+    out << "        myproto_struct::put<uint32_t>(p, kSchemaId);\n";
+    bool hasVariable = false;
+    for (size_t i = 0; i < msg.fields.size(); i++) {
+        const Field& f = msg.fields[i];
+        const FieldType& t = types.at(f.type);
+        if (t.variable) {
+            hasVariable = true;
+            out << "        myproto_struct::put<uint32_t>(p + " << offsetName(f.name) << ", static_cast<uint32_t>("
+                << f.name << ".size()));\n";
+        } else {
+            out << "        myproto_struct::put<" << t.cppType << ">(p + " << offsetName(f.name) << ", " << f.name << ");\n";
+        }
+    }
+    if (hasVariable) {
+        out << "        uint8_t* var = p + kFixedSize;\n";
+        for (size_t i = 0; i < msg.fields.size(); i++) {
+            const Field& f = msg.fields[i];
+            if (types.at(f.type).variable) {
+                out << "        memcpy(var, " << f.name << ".data(), " << f.name << ".size());\n";
+                out << "        var += " << f.name << ".size();\n";
+            }
+        }
+    }
+    out << "        buf->hasWritten(size);\n";
+    out << "        return true;\n";
+    out << "    }\n\n";
+
+    // decode
+    out << "    // 直接从消息体字节中读取，指纹或长度不符时返回false\n";
+    out << "    static bool decode(const char* data, size_t len, " << msg.name << "& out) {\n";
+    out << "        const uint8_t* p = reinterpret_cast<const uint8_t*>(data);\n";
+    out << "        if (len < kFixedSize || myproto_struct::get<uint32_t>(p) != kSchemaId) {\n";
+    out << "            return false;\n";
+    out << "        }\n";
+    for (size_t i = 0; i < msg.fields.size(); i++) {
+        const Field& f = msg.fields[i];
+        const FieldType& t = types.at(f.type);
+        if (!t.variable) {
+            out << "        out." << f.name << " = myproto_struct::get<" << t.cppType << ">(p + " << offsetName(f.name)
+                << ");\n";
+        }
+    }
+    out << "        size_t var = kFixedSize;\n";
+    for (size_t i = 0; i < msg.fields.size(); i++) {
+        const Field& f = msg.fields[i];
+        if (types.at(f.type).variable) {
+            out << "        {\n";
+            out << "            uint32_t n = myproto_struct::get<uint32_t>(p + " << offsetName(f.name) << ");\n";
+            out << "            if (n > MY_PROTO_MAX_JSON_STRING_LEN || n > len - var) {\n";
+            out << "                return false;\n";
+            out << "            }\n";
+            out << "            out." << f.name << ".assign(data + var, n);\n";
+            out << "            var += n;\n";
+            out << "        }\n";
+        }
+    }
+    out << "        return var == len;\n";
+    out << "    }\n\n";
+
+    // toJson / fromJson
+    out << "    json toJson() const {\n";
+    out << "        json j = json::object();\n";
+    for (size_t i = 0; i < msg.fields.size(); i++) {
+        const Field& f = msg.fields[i];
+        out << "        j[\"" << f.name << "\"] = " << f.name << ";\n";
+    }
+    out << "        return j;\n";
+    out << "    }\n\n";
+
+    out << "    static bool fromJson(const json& j, " << msg.name << "& out) {\n";
+    out << "        if (!j.is_object()) {\n";
+    out << "            return false;\n";
+    out << "        }\n";
+    out << "        try {\n";
+    for (size_t i = 0; i < msg.fields.size(); i++) {
+        const Field& f = msg.fields[i];
+        out << "            out." << f.name << " = j.at(\"" << f.name << "\").get<" << types.at(f.type).cppType << ">();\n";
+    }
+    out << "        } catch (const json::exception& e) {\n";
+    out << "            std::cerr << \"" << msg.name << " fromJson error: \" << e.what() << std::endl;\n";
+    out << "            return false;\n";
+    out << "        }\n";
+    out << "        return true;\n";
+    out << "    }\n";
+    out << "};\n\n";
+}
+
+string includeGuard(const string& path) {
+    size_t slash = path.find_last_of("/\\");
+    string base = slash == string::npos ? path : path.substr(slash + 1);
+    string guard = "__MY_PROTO_GEN_";
+    for (size_t i = 0; i < base.size(); i++) {
+        guard += isalnum(static_cast<unsigned char>(base[i])) ? static_cast<char>(toupper(static_cast<unsigned char>(base[i]))) : '_';
+    }
+    return guard;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        cerr << "usage: " << argv[0] << " <input.schema> <output.h>" << endl;
+        return 1;
+    }
+
+    ifstream in(argv[1]);
+    if (!in) {
+        cerr << "cannot open schema file " << argv[1] << endl;
+        return 1;
+    }
+    stringstream text;
+    text << in.rdbuf();
+
+    vector<Message> messages;
+    try {
+        messages = parseSchema(text.str());
+    } catch (const exception& e) {
+        cerr << argv[1] << ": " << e.what() << endl;
+        return 1;
+    }
+
+    ostringstream out;
+    string guard = includeGuard(argv[2]);
+    out << "// 由myproto_gen根据" << argv[1] << "生成，请勿手工修改\n";
+    out << "#ifndef " << guard << "\n";
+    out << "#define " << guard << "\n\n";
+    out << "#include <stdint.h>\n";
+    out << "#include <string.h>\n";
+    out << "#include <string>\n";
+    out << "#include \"MyProtoStruct.h\"\n\n";
+    for (size_t i = 0; i < messages.size(); i++) {
+        generateMessage(out, messages[i]);
+    }
+    out << "#endif // " << guard << "\n";
+
+    ofstream file(argv[2]);
+    if (!file || !(file << out.str())) {
+        cerr << "cannot write " << argv[2] << endl;
+        return 1;
+    }
+    return 0;
+}
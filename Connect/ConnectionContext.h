@@ -0,0 +1,28 @@
+#ifndef __CONNECTION_CONTEXT_H
+#define __CONNECTION_CONTEXT_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "myproto.h"
+#include "ReliableMsgManager.h"
+#include "WorkStealingPool.h"
+
+// 每个TCP连接独立的上下文，在onConnection中创建并通过TcpConnection::setContext挂到连接上
+// 不同连接的半包解析状态、可靠性状态互不影响；上下文只在连接所属的IO线程中读写
+struct ConnectionContext {
+    uint32_t connId = 0; // 连接ID（进程内唯一）
+    std::string connName; // 连接名称（缓存）
+    MyProtoDecode decoder; // 该连接专用的协议解码器
+    ReliableMsgManager* reliableManager = nullptr; // 连接所属IO线程的可靠消息管理器
+    // 该连接的可靠性状态，握手恢复会话时被替换（adoptSession）；只在IO线程读写，
+    // 其他线程发送消息时不读取它，序列号到IO线程才在当时的状态上分配（见ConnectionHandler::sendMessage）
+    ReliableConnStatePtr reliable;
+    bool awaitingSession = false; // 要恢复的会话还挂在没断开的旧连接上，接管前收到的数据帧丢弃（对端会重传）
+    // 懒解析模式下交出接收字节的缓冲区块，消息引用着块时不能复用；消息释放后块连同容量一起回收
+    std::vector<std::shared_ptr<muduo::net::Buffer>> bodyBlocks;
+    std::shared_ptr<WorkStealingStrand> strand; // 业务处理在线程池中执行时，保证该连接的消息按顺序处理
+};
+typedef std::shared_ptr<ConnectionContext> ConnectionContextPtr;
+
+#endif // __CONNECTION_CONTEXT_H
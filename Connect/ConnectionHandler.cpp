@@ -1,15 +1,66 @@
 #include "ConnectionHandler.h"
 #include "BusinessHandler.h"
+#include "muduo/net/EventLoop.h"
 #include <iostream>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace {
+// 会话ID相当于恢复会话的凭据，必须不可预测：取内核的密码学安全随机数（getrandom，不支持时读/dev/urandom）
+bool secureRandom(void* out, size_t len) {
+    uint8_t* p = static_cast<uint8_t*>(out);
+    size_t done = 0;
+#ifdef SYS_getrandom
+    while (done < len) {
+        long n = syscall(SYS_getrandom, p + done, len - done, 0);
+        if (n > 0) {
+            done += static_cast<size_t>(n);
+        } else if (n < 0 && errno != EINTR) {
+            break;
+        }
+    }
+    if (done == len) {
+        return true;
+    }
+#endif
+    int fd = ::open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    while (done < len) {
+        ssize_t n = ::read(fd, p + done, len - done);
+        if (n > 0) {
+            done += static_cast<size_t>(n);
+        } else if (n == 0 || errno != EINTR) {
+            break;
+        }
+    }
+    ::close(fd);
+    return done == len;
+}
+}
 
 // 修复构造函数，确保正确初始化connectionCallback_
-ConnectionHandler::ConnectionHandler() {
-    decoder_.init();
+ConnectionHandler::ConnectionHandler()
+    : nextConnId_(1),
+      lazyBody_(false),
+      delayedAckMs_(DELAYED_ACK_MS),
+      delayedAckMessages_(DELAYED_ACK_MESSAGES),
+      sessionClient_(false),
+      clientSessionManager_(nullptr),
+      clientRetainSerial_(0),
+      alive_(std::make_shared<bool>(true)) {
     connectionCallback_ = nullptr; // 确保回调初始化为nullptr
     std::cout << "[Handler] Constructor: connectionCallback_ initialized to nullptr" << std::endl;
 }
 
 ConnectionHandler::~ConnectionHandler() {
+    // 先停止线程池，保证不再有任务访问本对象
+    if (workerPool_) {
+        workerPool_->stop();
+    }
 }
 
 void ConnectionHandler::setBusinessHandler(std::shared_ptr<BusinessHandler> handler) {
@@ -20,55 +71,115 @@ void ConnectionHandler::setMessageCallback(const MessageCallback& cb) {
     messageCallback_ = cb;
 }
 
+void ConnectionHandler::setBackpressureCallback(const BackpressureCallback& cb) {
+    backpressureCallback_ = cb;
+}
+
 // 修改onMessage方法，在业务处理后触发回调
 void ConnectionHandler::onMessage(const TcpConnectionPtr& conn, muduo::net::Buffer* buf, muduo::Timestamp time) {
     std::cout << time.toString() << " OnMessage called for connection: " << conn->name() 
               << ", readable bytes: " << buf->readableBytes() << std::endl;
     
-    // 从buffer中读取数据并解析
-    while (buf->readableBytes() > 0) {
-        size_t readable = buf->readableBytes();
-        std::cout << "[Handler] Attempting to parse " << readable << " bytes" << std::endl;
+    ConnectionContext* ctx = getContext(conn);
+    if (!ctx) {
+        std::cout << "[Handler] No context for connection " << conn->name() << ", discarding data" << std::endl;
+        buf->retrieveAll();
+        return;
+    }
+    MyProtoDecode& decoder = ctx->decoder;
+    
+    // 直接在muduo Buffer上原地解析完整的帧，只取走已解析的字节，末尾不完整的帧留在Buffer中
+    size_t consumed = 0;
+    bool parsed = true;
+    if (decoder.lazyBody()) {
+        // 懒解析：先在输入缓冲区上原地解析，消息以一个空闲块作为字节的持有者；
+        // 只有消息确实引用了消息体字节时才把输入缓冲区和该块交换（vector交换，字节地址不变），
+        // 输入缓冲区换到回收块原有的容量，不需要分配；只有控制帧时照常retrieve，不交换
+        std::shared_ptr<muduo::net::Buffer> block = acquireBodyBlock(ctx);
+        long owners = block.use_count();
+        parsed = decoder.parserInPlace(reinterpret_cast<const uint8_t*>(buf->peek()), buf->readableBytes(), consumed, block);
+        if (block.use_count() > owners) {
+            block->swap(*buf);
+            block->retrieve(consumed);
+            // 末尾不完整的帧放回连接的输入缓冲区，块中只留下被消息引用的帧
+            buf->append(block->peek(), block->readableBytes());
+            block->retrieveAll();
+        } else {
+            buf->retrieve(consumed);
+        }
+    } else {
+        parsed = decoder.parserInPlace(reinterpret_cast<const uint8_t*>(buf->peek()), buf->readableBytes(), consumed);
+        buf->retrieve(consumed);
+    }
+    if (!parsed) {
+        // 协议头非法，字节流已无法重新同步，丢弃剩余数据
+        std::cout << "[Handler] Invalid frame header, discarding " << buf->readableBytes() << " bytes" << std::endl;
+        buf->retrieveAll();
+    }
+    
+    // 处理解析出的消息
+    while (!decoder.empty()) {
+        auto msg = decoder.front();
+        decoder.pop();
+        std::cout << "[Handler] Processing message, type: " << static_cast<int>(msg->head.type) 
+                  << ", serverId: " << msg->head.server << std::endl;
         
-        if (decoder_.parser(const_cast<void*>(static_cast<const void*>(buf->peek())), readable)) {
-            std::cout << "[Handler] Parser succeeded, retrieving " << readable << " bytes" << std::endl;
-            buf->retrieve(readable);
-            
-            // 处理解析出的消息
-            std::cout << "[Handler] Messages in queue: " << (decoder_.empty() ? "0" : "not empty") << std::endl;
-            while (!decoder_.empty()) {
-                auto msg = decoder_.front();
-                decoder_.pop();
-                std::cout << "[Handler] Processing message, type: " << msg->head.type 
-                          << ", serverId: " << msg->head.server << std::endl;
-                
-                // 根据消息类型处理
-                if (msg->head.type == 1) { // 确认消息
-                    reliableManager_.processAckMessage(conn, *msg);
-                } else { // 数据消息
-                    if (reliableManager_.processDataMessage(conn, *msg)) {
-                        std::cout << "[Handler] Processing new data message, sending to business handler" << std::endl;
-                        // 新消息，交给业务层处理
-                        if (businessHandler_) {
-                            std::cout << "[Handler] Business handler exists, calling handleMessage" << std::endl;
-                            businessHandler_->handleMessage(conn, msg);
-                        } else {
-                            std::cout << "[Handler] WARNING: No business handler set!" << std::endl;
-                        }
-                        // 触发用户回调
-                        if (messageCallback_) {
-                            messageCallback_(conn, msg);
-                        }
-                    } else {
-                        std::cout << "[Handler] Duplicate or invalid message, skipped" << std::endl;
-                    }
+        // 根据消息类型处理
+        if (msg->head.type == MY_PROTO_TYPE_HELLO) { // 会话握手
+            handleHello(conn, ctx, *msg);
+        } else if (ctx->awaitingSession) {
+            std::cout << "[Handler] Waiting for session handover, message dropped" << std::endl;
+        } else if (msg->head.type != MY_PROTO_TYPE_DATA) { // 确认等控制消息
+            ctx->reliableManager->processAckMessage(conn, *ctx->reliable, *msg);
+        } else { // 数据消息
+            if (ctx->reliableManager->processDataMessage(conn, *ctx->reliable, *msg)) {
+                std::cout << "[Handler] Processing new data message, sending to business handler" << std::endl;
+                // 新消息，交给业务层处理：启用线程池时投递到该连接的strand，否则在IO线程中直接处理
+                if (ctx->strand) {
+                    ctx->strand->post([this, conn, msg]() {
+                        dispatchMessage(conn, msg);
+                    });
+                } else {
+                    dispatchMessage(conn, msg);
                 }
+            } else {
+                std::cout << "[Handler] Duplicate or invalid message, skipped" << std::endl;
             }
+        }
+    }
+}
+
+// 取一个没有被消息引用的块，池中的块都还被引用时新建一个
+std::shared_ptr<muduo::net::Buffer> ConnectionHandler::acquireBodyBlock(ConnectionContext* ctx) {
+    for (const std::shared_ptr<muduo::net::Buffer>& block : ctx->bodyBlocks) {
+        if (block.use_count() == 1) {
+            // 消息可能在其他线程中释放，获取屏障保证它们对块中字节的读取先于这里的复用
+            std::atomic_thread_fence(std::memory_order_acquire);
+            block->retrieveAll();
+            return block;
+        }
+    }
+    std::shared_ptr<muduo::net::Buffer> block = std::make_shared<muduo::net::Buffer>();
+    if (ctx->bodyBlocks.size() < BODY_BLOCK_POOL_SIZE) {
+        ctx->bodyBlocks.push_back(block);
+    }
+    return block;
+}
+
+void ConnectionHandler::dispatchMessage(const TcpConnectionPtr& conn, const std::shared_ptr<MyProtoMsg>& msg) {
+    try {
+        if (businessHandler_) {
+            businessHandler_->handleMessage(conn, msg);
         } else {
-            // 数据不完整，等待更多数据
-            std::cout << "[Handler] Parser failed, waiting for more data" << std::endl;
-            break;
+            std::cout << "[Handler] WARNING: No business handler set!" << std::endl;
+        }
+        // 触发用户回调
+        if (messageCallback_) {
+            messageCallback_(conn, msg);
         }
+    } catch (const std::exception& e) {
+        // 在线程池中执行时异常不能逃出worker线程
+        std::cerr << "[Handler] Message dispatch exception: " << e.what() << std::endl;
     }
 }
 
@@ -77,12 +188,96 @@ void ConnectionHandler::onWriteComplete(const TcpConnectionPtr& conn) {
     std::cout << "Write complete for connection: " << conn->name() << std::endl;
 }
 
-uint32_t ConnectionHandler::sendMessage(const TcpConnectionPtr& conn, const MyProtoMsg& msg) {
-    return reliableManager_.sendReliableMessage(conn, msg);
+uint32_t ConnectionHandler::sendMessage(const TcpConnectionPtr& conn, const MyProtoMsg& msg,
+                                        const DeliveryAckedCallback& onAcked, const DeliveryFailedCallback& onFailed) {
+    ConnectionContext* ctx = getContext(conn);
+    if (!ctx) {
+        std::cout << "Error: Connection has no context" << std::endl;
+        return 0;
+    }
+    muduo::net::EventLoop* loop = conn->getLoop();
+    if (loop->isInLoopThread()) {
+        // 与其他线程发送时一样返回提交编号，调用方不必区分所在线程；没有回调时不分配，待确认列表中只多一个空指针
+        uint32_t ticket = ReliableMsgManager::allocateTicket();
+        DeliveryCallbacksPtr callbacks = ReliableMsgManager::ticketCallbacks(ticket, onAcked, onFailed);
+        return ctx->reliableManager->sendReliableMessage(conn, *ctx->reliable, msg, callbacks) != 0 ? ticket : 0;
+    }
+    
+    // 其他线程发送：消息体在调用线程序列化，序列号到IO线程确定能发出时才分配，
+    // 并发的发送方按到达IO线程的顺序占用序列号，没能发出的消息不占用序列号；连接状态不跨线程访问
+    MyProtoMsg prepared;
+    if (!ReliableMsgManager::prepareBody(msg, prepared)) {
+        std::cout << "Failed to encode message" << std::endl;
+        return 0;
+    }
+    uint32_t ticket = ReliableMsgManager::allocateTicket();
+    DeliveryCallbacksPtr callbacks = ReliableMsgManager::ticketCallbacks(ticket, onAcked, onFailed);
+    // 提交编号已经返回给调用方，到IO线程后没能发出时通过onFailed通知
+    // 可靠性状态在IO线程中取：会话恢复替换了状态时消息在恢复后的会话上发出，不会用到旧状态的序列号
+    loop->runInLoop([conn, prepared, callbacks]() {
+        ConnectionContext* ctx = getContext(conn);
+        uint32_t sent = 0;
+        if (ctx) {
+            sent = ctx->reliableManager->sendReliableMessage(conn, *ctx->reliable, prepared, callbacks);
+        }
+        if (sent == 0 && callbacks && callbacks->onFailed) {
+            callbacks->onFailed(0, ctx && conn->connected() ? DELIVERY_QUEUE_FULL : DELIVERY_CONNECTION_CLOSED);
+        }
+    });
+    return ticket;
+}
+
+ConnectionContext* ConnectionHandler::getContext(const TcpConnectionPtr& conn) {
+    if (!conn) {
+        return nullptr;
+    }
+    ConnectionContextPtr* ctx = boost::any_cast<ConnectionContextPtr>(conn->getMutableContext());
+    return ctx ? ctx->get() : nullptr;
+}
+
+ReliableMsgManager* ConnectionHandler::initLoop(muduo::net::EventLoop* loop) {
+    std::lock_guard<std::mutex> lock(loopMutex_);
+    std::unique_ptr<ReliableMsgManager>& manager = loopManagers_[loop];
+    if (!manager) {
+        manager.reset(new ReliableMsgManager(loop));
+        manager->setDelayedAck(delayedAckMs_, delayedAckMessages_);
+        for (const auto& policy : retryPolicies_) {
+            manager->setRetryPolicy(policy.first, policy.second);
+        }
+        manager->setBackpressureCallback([this](const TcpConnectionPtr& conn, bool full) {
+            if (backpressureCallback_) {
+                backpressureCallback_(conn, full);
+            }
+        });
+    }
+    return manager.get();
+}
+
+void ConnectionHandler::checkTimeoutMessages(muduo::net::EventLoop* loop) {
+    ReliableMsgManager* manager = NULL;
+    {
+        std::lock_guard<std::mutex> lock(loopMutex_);
+        auto it = loopManagers_.find(loop);
+        if (it != loopManagers_.end()) {
+            manager = it->second.get();
+        }
+    }
+    if (manager) {
+        manager->checkTimeoutMessages();
+    }
 }
 
 void ConnectionHandler::checkTimeoutMessages() {
-    reliableManager_.checkTimeoutMessages();
+    std::lock_guard<std::mutex> lock(loopMutex_);
+    for (auto& loopPair : loopManagers_) {
+        muduo::net::EventLoop* loop = loopPair.first;
+        ReliableMsgManager* manager = loopPair.second.get();
+        if (loop->isInLoopThread()) {
+            manager->checkTimeoutMessages();
+        } else {
+            loop->runInLoop([manager]() { manager->checkTimeoutMessages(); });
+        }
+    }
 }
 
 // 在文件中添加onConnection方法实现
@@ -92,12 +287,44 @@ void ConnectionHandler::onConnection(const TcpConnectionPtr& conn) {
         std::cout << "[Handler] New connection established: " << conn->name() << " from "
                   << conn->peerAddress().toIpPort() << " to "
                   << conn->localAddress().toIpPort() << std::endl;
+        // 为连接创建独立的上下文：解码器、连接ID和可靠性状态
+        ConnectionContextPtr ctx = std::make_shared<ConnectionContext>();
+        ctx->connId = nextConnId_++;
+        ctx->connName = conn->name();
+        ctx->decoder.init();
+        ctx->decoder.setLazyBody(lazyBody_);
+        ctx->reliableManager = initLoop(conn->getLoop());
+        if (sessionClient_ && clientSession_) {
+            // 重连：沿用断开前的会话，先发HELLO让对端恢复会话，再重放未确认的消息
+            ctx->reliable = clientSession_;
+            clientSession_.reset();
+            ctx->reliableManager->sendHello(conn, *ctx->reliable);
+            ctx->reliableManager->resumeConnection(conn, ctx->reliable, 0);
+        } else {
+            ctx->reliable = ctx->reliableManager->addConnection(conn);
+            if (sessionClient_) {
+                ctx->reliableManager->sendHello(conn, *ctx->reliable);
+            }
+        }
+        if (workerPool_) {
+            ctx->strand = std::make_shared<WorkStealingStrand>(workerPool_.get());
+        }
+        conn->setContext(ctx);
         // 添加连接计数和状态日志
-        std::cout << "[Handler] Current connection status: CONNECTED" << std::endl;
+        std::cout << "[Handler] Current connection status: CONNECTED, connId: " << ctx->connId << std::endl;
+        // 上下文已经挂到连接上，监听者可以取用连接的可靠性状态
+        if (connectionCallback_) {
+            connectionCallback_(conn);
+        }
     } else {
         std::cout << "[Handler] Connection closed: " << conn->name() << std::endl;
         // 连接关闭时清理相关资源
-        reliableManager_.cleanupConnection(conn->name());
+        ConnectionContext* ctx = getContext(conn);
+        if (ctx && ctx->reliable->sessionId != 0) {
+            retainSession(conn, ctx);
+        } else if (ctx) {
+            ctx->reliableManager->cleanupConnection(*ctx->reliable);
+        }
         // 通知连接断开事件给监听者
         if (connectionCallback_) {
             std::cout << "[Handler] Triggering connection callback" << std::endl;
@@ -112,4 +339,270 @@ void ConnectionHandler::onConnection(const TcpConnectionPtr& conn) {
 void ConnectionHandler::setConnectionCallback(const ConnectionCallback& cb) {
     std::cout << "[Handler] Setting connection callback" << std::endl;
     connectionCallback_ = cb;
-}
\ No newline at end of file
+}
+
+void ConnectionHandler::setLazyBody(bool lazy) {
+    lazyBody_ = lazy;
+}
+
+void ConnectionHandler::setDelayedAck(int delayMs, uint32_t maxMessages) {
+    delayedAckMs_ = delayMs;
+    delayedAckMessages_ = maxMessages;
+}
+
+void ConnectionHandler::setRetryPolicy(uint16_t server, const RetryPolicy& policy) {
+    retryPolicies_[server] = policy;
+}
+
+void ConnectionHandler::enableSessionResumption(bool enable) {
+    sessionClient_ = enable;
+}
+
+void ConnectionHandler::releaseClientSession() {
+    if (!clientSession_) {
+        return;
+    }
+    ReliableConnStatePtr state = clientSession_;
+    clientSession_.reset();
+    clientSessionManager_->cleanupConnection(*state);
+}
+
+void ConnectionHandler::setWorkerThreads(size_t numThreads) {
+    if (workerPool_) {
+        workerPool_->stop();
+        workerPool_.reset();
+    }
+    if (numThreads > 0) {
+        workerPool_.reset(new WorkStealingPool(numThreads));
+        workerPool_->start();
+    }
+}
+
+void ConnectionHandler::handleHello(const TcpConnectionPtr& conn, ConnectionContext* ctx, const MyProtoMsg& msg) {
+    uint64_t sessionId = 0;
+    uint32_t peerAck = 0;
+    uint32_t peerBase = 0;
+    if (!ReliableMsgManager::parseHello(msg, sessionId, peerAck, peerBase)) {
+        std::cout << "[Handler] Malformed HELLO frame, length: " << msg.raw.len << std::endl;
+        return;
+    }
+    ReliableConnState& state = *ctx->reliable;
+    
+    if (sessionClient_) {
+        // 服务端回复的会话ID与本端一致说明会话已经恢复，确认号释放对端已收到的消息；
+        // 不一致说明服务端没有保留会话（已过期或重启过），以新会话继续，去重窗口从对端的发送起点开始
+        if (sessionId == state.sessionId) {
+            ctx->reliableManager->processPiggybackAck(conn, state, peerAck);
+        } else {
+            if (state.sessionId != 0) {
+                std::cout << "[Handler] Session " << state.sessionId << " not resumed by peer, new session: " << sessionId << std::endl;
+            }
+            state.receivedWindow.reset(peerBase);
+            state.sessionId = sessionId;
+        }
+        return;
+    }
+    
+    if (state.sessionId != 0 || ctx->awaitingSession) {
+        return; // 连接已经握手过
+    }
+    ReliableConnStatePtr resumed;
+    TcpConnectionPtr previous;
+    TcpConnectionPtr superseded;
+    bool waiting = false;
+    std::vector<SessionRecord> expired;
+    {
+        std::lock_guard<std::mutex> lock(sessionMutex_);
+        takeExpiredSessions(expired);
+        auto it = sessionId != 0 ? sessions_.find(sessionId) : sessions_.end();
+        if (it != sessions_.end() && !it->second.attached) {
+            it->second.attached = true;
+            it->second.conn = conn;
+            resumed = it->second.state;
+        } else if (it != sessions_.end()) {
+            // 对端重连了而旧连接在本端还没断开（半开连接），关闭旧连接，断开后把会话转交过来；
+            // 之前等待的连接已经被这次重连取代，一并关闭
+            superseded = it->second.waiter.lock();
+            it->second.waiter = conn;
+            it->second.waiterAck = peerAck;
+            previous = it->second.conn.lock();
+            waiting = true;
+        } else {
+            // 对端在旧会话上分配的序列号接着用（本端没有保留会话时也是），去重窗口从它的发送起点开始
+            state.receivedWindow.reset(peerBase);
+            uint64_t id = 0;
+            while (id == 0 || sessions_.count(id)) {
+                if (!secureRandom(&id, sizeof(id))) {
+                    // 拿不到安全的随机数时不建立会话：连接照常使用，只是断开后不能恢复
+                    std::cerr << "[Handler] No secure random source, session not created" << std::endl;
+                    id = 0;
+                    break;
+                }
+            }
+            if (id != 0) {
+                state.sessionId = id;
+                SessionRecord record;
+                record.state = ctx->reliable;
+                record.conn = conn;
+                sessions_[id] = record;
+            }
+        }
+    }
+    discardSessions(expired);
+    
+    if (resumed) {
+        adoptSession(conn, ctx, resumed, peerAck);
+    } else if (waiting) {
+        std::cout << "[Handler] Session " << sessionId << " still attached, closing previous connection" << std::endl;
+        ctx->awaitingSession = true;
+        if (previous) {
+            previous->forceClose();
+        }
+        if (superseded) {
+            superseded->forceClose();
+        }
+    } else {
+        if (sessionId != 0) {
+            std::cout << "[Handler] Unknown or expired session " << sessionId << ", new session: " << state.sessionId << std::endl;
+        }
+        ctx->reliableManager->sendHello(conn, state);
+    }
+}
+
+void ConnectionHandler::adoptSession(const TcpConnectionPtr& conn, ConnectionContext* ctx, const ReliableConnStatePtr& session,
+                                     uint32_t peerAck) {
+    // 替换ctx->reliable必须在连接所属的IO线程，其他线程提交的消息在这之后才取状态，不会与替换竞争
+    conn->getLoop()->assertInLoopThread();
+    // 握手前新建的状态上没有会话数据，直接丢弃
+    ctx->reliableManager->cleanupConnection(*ctx->reliable);
+    ctx->reliable = session;
+    ctx->awaitingSession = false;
+    ctx->reliableManager->sendHello(conn, *session);
+    ctx->reliableManager->resumeConnection(conn, session, peerAck);
+}
+
+void ConnectionHandler::retainSession(const TcpConnectionPtr& conn, ConnectionContext* ctx) {
+    ReliableConnStatePtr state = ctx->reliable;
+    ReliableMsgManager* manager = ctx->reliableManager;
+    manager->detachConnection(*state);
+    if (sessionClient_) {
+        // 客户端只有一条连接，重连时在同一个loop中恢复；保留期满仍没有重连成功时清理，
+        // 确定不重连时由客户端调用releaseClientSession立即清理
+        clientSession_ = state;
+        clientSessionManager_ = manager;
+        uint64_t serial = ++clientRetainSerial_;
+        std::weak_ptr<bool> alive = alive_;
+        conn->getLoop()->runAfter(SESSION_RETAIN_MS / 1000.0, [this, alive, serial]() {
+            if (!alive.lock()) {
+                return; // 处理器已销毁
+            }
+            if (clientSession_ && clientRetainSerial_ == serial) {
+                std::cout << "[Handler] Session " << clientSession_->sessionId << " expired" << std::endl;
+                releaseClientSession();
+            }
+        });
+        return;
+    }
+    
+    TcpConnectionPtr waiter;
+    uint32_t waiterAck = 0;
+    bool known = false;
+    std::vector<SessionRecord> expired;
+    {
+        std::lock_guard<std::mutex> lock(sessionMutex_);
+        auto it = sessions_.find(state->sessionId);
+        if (it != sessions_.end() && it->second.state == state) {
+            known = true;
+            SessionRecord& record = it->second;
+            waiter = record.waiter.lock();
+            waiterAck = record.waiterAck;
+            record.waiter.reset();
+            if (waiter) {
+                record.conn = waiter;
+            } else {
+                record.attached = false;
+                record.conn.reset();
+                record.manager = manager;
+                record.loop = conn->getLoop();
+                record.detachedAt = std::chrono::steady_clock::now();
+            }
+        }
+        takeExpiredSessions(expired);
+    }
+    discardSessions(expired);
+    if (!known) {
+        manager->cleanupConnection(*state);
+        return;
+    }
+    if (!waiter) {
+        std::cout << "[Handler] Session " << state->sessionId << " retained for " << SESSION_RETAIN_MS << "ms" << std::endl;
+        scheduleSessionSweep(conn->getLoop());
+        return;
+    }
+    
+    // 转交给等待的新连接，它可能属于另一个IO线程，在那里完成接管
+    muduo::net::EventLoop* loop = conn->getLoop();
+    waiter->getLoop()->runInLoop([this, waiter, state, waiterAck, manager, loop]() {
+        ConnectionContext* waiterCtx = getContext(waiter);
+        if (waiterCtx && waiterCtx->awaitingSession && waiter->connected()) {
+            adoptSession(waiter, waiterCtx, state, waiterAck);
+            return;
+        }
+        // 新连接也已经断开，会话继续保留
+        std::lock_guard<std::mutex> lock(sessionMutex_);
+        auto it = sessions_.find(state->sessionId);
+        if (it != sessions_.end() && it->second.state == state) {
+            it->second.attached = false;
+            it->second.conn.reset();
+            it->second.manager = manager;
+            it->second.loop = loop;
+            it->second.detachedAt = std::chrono::steady_clock::now();
+            scheduleSessionSweep(loop);
+        }
+    });
+}
+
+// 保留期满的会话由断开时设置的loop定时器清理，建立、断开和握手时也顺带检查
+void ConnectionHandler::takeExpiredSessions(std::vector<SessionRecord>& expired) {
+    auto deadline = std::chrono::steady_clock::now() - std::chrono::milliseconds(SESSION_RETAIN_MS);
+    for (auto it = sessions_.begin(); it != sessions_.end();) {
+        if (!it->second.attached && it->second.detachedAt <= deadline) {
+            expired.push_back(it->second);
+            it = sessions_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// 每个断开的会话设置一次，到期时清理所有期满的会话；会话期间又恢复过的不受影响（detachedAt已经更新）
+void ConnectionHandler::scheduleSessionSweep(muduo::net::EventLoop* loop) {
+    std::weak_ptr<bool> alive = alive_;
+    loop->runAfter(SESSION_RETAIN_MS / 1000.0, [this, alive]() {
+        if (!alive.lock()) {
+            return; // 处理器已销毁
+        }
+        sweepSessions();
+    });
+}
+
+void ConnectionHandler::sweepSessions() {
+    std::vector<SessionRecord> expired;
+    {
+        std::lock_guard<std::mutex> lock(sessionMutex_);
+        takeExpiredSessions(expired);
+    }
+    discardSessions(expired);
+}
+
+// 在会话最后所属的IO线程中清理，还没确认的消息在那里通知投递失败
+void ConnectionHandler::discardSessions(const std::vector<SessionRecord>& expired) {
+    for (const SessionRecord& record : expired) {
+        std::cout << "[Handler] Session " << record.state->sessionId << " expired" << std::endl;
+        ReliableMsgManager* manager = record.manager;
+        ReliableConnStatePtr state = record.state;
+        record.loop->runInLoop([manager, state]() {
+            manager->cleanupConnection(*state);
+        });
+    }
+}
@@ -1,11 +1,18 @@
 #ifndef __CONNECTION_HANDLER_H
 #define __CONNECTION_HANDLER_H
 
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 #include <muduo/net/TcpConnection.h>
 #include "myproto.h"
 #include "ReliableMsgManager.h"
+#include "ConnectionContext.h"
 
 class BusinessHandler;
 
@@ -14,6 +21,7 @@ public:
     using TcpConnectionPtr = muduo::net::TcpConnectionPtr;
     using MessageCallback = std::function<void(const TcpConnectionPtr&, std::shared_ptr<MyProtoMsg>)>;
     using ConnectionCallback = std::function<void(const TcpConnectionPtr&)>;
+    using BackpressureCallback = ReliableMsgManager::BackpressureCallback;
     
     ConnectionHandler();
     ~ConnectionHandler();
@@ -21,27 +29,114 @@ public:
     void setBusinessHandler(std::shared_ptr<BusinessHandler> handler);
     void setMessageCallback(const MessageCallback& cb);
     
-    // 设置连接回调
+    // 设置连接回调，连接建立（上下文创建之后）和断开（资源清理之后）时各调用一次
     void setConnectionCallback(const ConnectionCallback& cb);
     
+    // 设置背压回调：连接的发送窗口已满、排队的消息过多时以true调用，排队消息发出后以false调用
+    // 在连接所属的IO线程中执行，发送方应据此暂停或恢复向该连接发送
+    void setBackpressureCallback(const BackpressureCallback& cb);
+    
+    // 设置消息体懒解析：消息只引用接收缓冲区中的原始字节，业务首次调用getBody()时才构建JSON
+    // 对只转发、去重丢弃或没有注册处理函数的消息，可以省掉JSON解析（只影响之后建立的连接）
+    void setLazyBody(bool lazy);
+    
+    // 设置业务处理线程数：大于0时业务处理函数和消息回调在线程池中执行，同一连接的消息仍按接收顺序处理，
+    // 响应通过runInLoop交回连接所属的IO线程发送；0表示在IO线程中直接处理（只影响之后建立的连接）
+    void setWorkerThreads(size_t numThreads);
+    
+    // 设置延迟确认：收到按序消息后最多等待delayMs毫秒或maxMessages条消息再单独发送确认，
+    // 期间发出的数据帧捎带确认号（只影响之后创建的可靠消息管理器，应在initLoop之前调用）
+    void setDelayedAck(int delayMs, uint32_t maxMessages);
+    
+    // 设置服务号server的重传策略（最大重传次数、投递期限），同样只影响之后创建的可靠消息管理器
+    void setRetryPolicy(uint16_t server, const RetryPolicy& policy);
+    
+    // 作为会话发起方（客户端）启用会话恢复：连接建立时发HELLO握手，断开后保留会话，
+    // 重连时带上会话ID恢复并重放未确认的消息，对端保留的去重窗口丢弃重复的帧
+    // 接收方（服务端）不需要设置：收到HELLO的连接断开后会话保留SESSION_RETAIN_MS毫秒
+    void enableSessionResumption(bool enable);
+    // 客户端断开后不会重连时调用：清理保留的会话，还没确认的消息通知投递失败；需在连接所属的IO线程中调用
+    // 没有调用时保留的会话在SESSION_RETAIN_MS毫秒内仍没有重连成功也会清理
+    void releaseClientSession();
+    
     // 连接回调函数
     void onConnection(const TcpConnectionPtr& conn);
     void onMessage(const TcpConnectionPtr& conn, muduo::net::Buffer* buf, muduo::Timestamp time);
     void onWriteComplete(const TcpConnectionPtr& conn);
     
-    // 发送消息方法
-    uint32_t sendMessage(const TcpConnectionPtr& conn, const MyProtoMsg& msg);
+    // 发送消息方法，返回提交编号（非0，进程内递增），0表示没有发出
+    // 不论在哪个线程调用都返回提交编号而不是序列号：其他线程调用时序列号要到IO线程发出时才分配
+    // onAcked/onFailed可选：消息被对端确认时以首次发送到确认的延迟调用onAcked，放弃投递时以原因调用onFailed，
+    // 都在连接所属的IO线程中执行，第一个参数是提交编号；返回0时不会回调
+    uint32_t sendMessage(const TcpConnectionPtr& conn, const MyProtoMsg& msg,
+                         const DeliveryAckedCallback& onAcked = DeliveryAckedCallback(),
+                         const DeliveryFailedCallback& onFailed = DeliveryFailedCallback());
+    
+    // 为IO线程创建可靠消息管理器（重传定时器由该loop驱动），多线程服务器在线程初始化回调中调用；
+    // 未调用时在该线程上的第一个连接建立时创建
+    ReliableMsgManager* initLoop(muduo::net::EventLoop* loop);
     
-    // 定期检查超时消息
+    // 立即推进指定IO线程的重传时间轮，需在该线程中调用（重传本身由loop定时器按截止时间自动触发）
+    void checkTimeoutMessages(muduo::net::EventLoop* loop);
+    // 立即推进所有IO线程的重传时间轮，不在当前线程的转交给所属线程执行
     void checkTimeoutMessages();
     
+    // 获取连接上挂载的上下文，连接尚未建立上下文时返回nullptr
+    static ConnectionContext* getContext(const TcpConnectionPtr& conn);
+    
     // 在private部分添加connectionCallback_成员变量
     private:
-        MyProtoDecode decoder_; // 协议解码器
-        ReliableMsgManager reliableManager_; // 可靠消息管理器
+        // 业务处理和消息回调
+        void dispatchMessage(const TcpConnectionPtr& conn, const std::shared_ptr<MyProtoMsg>& msg);
+        // 懒解析模式下每个连接最多回收的缓冲区块数
+        static const size_t BODY_BLOCK_POOL_SIZE = 8;
+        // 取一个没有被消息引用的缓冲区块用来接管接收字节
+        static std::shared_ptr<muduo::net::Buffer> acquireBodyBlock(ConnectionContext* ctx);
+        
+        // 服务端保留的会话，按会话ID登记；会话可能在不同IO线程的连接之间转移，由sessionMutex_保护
+        struct SessionRecord {
+            ReliableConnStatePtr state;
+            bool attached = true; // 是否挂在连接上，保留期间为false
+            std::weak_ptr<muduo::net::TcpConnection> conn; // 当前挂接的连接
+            std::weak_ptr<muduo::net::TcpConnection> waiter; // 旧连接还没断开时等待接管会话的新连接
+            uint32_t waiterAck = 0; // 等待接管的新连接在HELLO中带来的确认号
+            ReliableMsgManager* manager = nullptr; // 断开时所属的管理器，保留期满后在它的loop中清理
+            muduo::net::EventLoop* loop = nullptr;
+            std::chrono::steady_clock::time_point detachedAt; // 断开时间
+        };
+        // 处理对端的HELLO：客户端确认会话是否恢复，服务端恢复或新建会话并回复HELLO
+        void handleHello(const TcpConnectionPtr& conn, ConnectionContext* ctx, const MyProtoMsg& msg);
+        // 服务端：在conn所属的IO线程中把保留的会话换到连接上，回复HELLO后重放未确认的消息
+        void adoptSession(const TcpConnectionPtr& conn, ConnectionContext* ctx, const ReliableConnStatePtr& session, uint32_t peerAck);
+        // 建立了会话的连接断开：保留会话；有新连接在等待时转交给它
+        void retainSession(const TcpConnectionPtr& conn, ConnectionContext* ctx);
+        // 取出保留期满的会话（需持有sessionMutex_），由discardSessions在各自的loop中清理
+        void takeExpiredSessions(std::vector<SessionRecord>& expired);
+        static void discardSessions(const std::vector<SessionRecord>& expired);
+        // 会话保留期满时在loop上清理期满的会话，不依赖之后有没有连接事件
+        void scheduleSessionSweep(muduo::net::EventLoop* loop);
+        void sweepSessions();
+        
+
+        std::atomic<uint32_t> nextConnId_; // 下一个分配的连接ID
+        bool lazyBody_; // 新连接是否启用消息体懒解析
+        int delayedAckMs_; // 延迟确认的最长时间
+        uint32_t delayedAckMessages_; // 累计多少条按序消息后立即确认
+        std::map<uint16_t, RetryPolicy> retryPolicies_; // 按服务号配置的重传策略，创建管理器时下发
+        bool sessionClient_; // 是否作为会话发起方
+        ReliableConnStatePtr clientSession_; // 客户端断开后保留的会话，重连时恢复；只在连接所属的IO线程访问
+        ReliableMsgManager* clientSessionManager_; // 保留的客户端会话断开前所属的管理器，清理时使用
+        uint64_t clientRetainSerial_; // 客户端每次保留会话时加1，之前保留期的定时器据此失效
+        std::mutex sessionMutex_; // 保护sessions_，只在连接建立、断开和握手时使用
+        std::unordered_map<uint64_t, SessionRecord> sessions_; // 服务端的会话表
+        std::mutex loopMutex_; // 只保护loopManagers_的增删查，不在消息热路径上
+        std::map<muduo::net::EventLoop*, std::unique_ptr<ReliableMsgManager>> loopManagers_; // 每个IO线程一个可靠消息管理器
         std::shared_ptr<BusinessHandler> businessHandler_; // 业务处理器
         MessageCallback messageCallback_; // 消息回调
         ConnectionCallback connectionCallback_; // 连接回调
+        BackpressureCallback backpressureCallback_; // 背压回调
+        std::shared_ptr<bool> alive_; // loop定时器回调通过weak_ptr判断处理器是否还存在
+        std::unique_ptr<WorkStealingPool> workerPool_; // 业务处理线程池（未启用时为空），最后声明以便最先析构
 };
 
 #endif // __CONNECTION_HANDLER_H
\ No newline at end of file
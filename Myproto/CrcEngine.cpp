@@ -0,0 +1,240 @@
+#include "CrcEngine.h"
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRC_ENGINE_HAVE_PCLMUL 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const uint16_t CRC16_POLY = 0x1021; // 与myproto.cpp中的CRC_POLYNOMIAL一致
+
+// x^n mod P，用于生成PCLMULQDQ折叠常量
+uint64_t xPowMod(unsigned n) {
+    uint32_t r = 1;
+    for (unsigned i = 0; i < n; i++) {
+        r <<= 1;
+        if (r & 0x10000)
+            r ^= 0x10000 | CRC16_POLY;
+    }
+    return r;
+}
+
+// 查表法用到的表：t[k][i]为字节i后面再跟k个0字节时的CRC（寄存器初始为0）
+struct CrcTables {
+    uint16_t t[16][256];
+    uint64_t k128Hi, k128Lo; // x^192 mod P, x^128 mod P：折叠16字节
+    uint64_t k512Hi, k512Lo; // x^576 mod P, x^512 mod P：折叠64字节
+
+    CrcTables() {
+        for (int i = 0; i < 256; i++) {
+            uint16_t crc = (uint16_t)(i << 8);
+            for (int j = 0; j < 8; j++)
+                crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ CRC16_POLY) : (uint16_t)(crc << 1);
+            t[0][i] = crc;
+        }
+        for (int k = 1; k < 16; k++) {
+            for (int i = 0; i < 256; i++) {
+                uint16_t prev = t[k - 1][i];
+                t[k][i] = (uint16_t)((prev << 8) ^ t[0][prev >> 8]);
+            }
+        }
+        k128Hi = xPowMod(192);
+        k128Lo = xPowMod(128);
+        k512Hi = xPowMod(576);
+        k512Lo = xPowMod(512);
+    }
+};
+
+const CrcTables& tables() {
+    static const CrcTables t;
+    return t;
+}
+
+uint16_t updateBitwise(uint16_t crc, const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)(data[i] << 8);
+        for (uint8_t j = 0; j < 8; j++) {
+            if (crc & 0x8000)
+                crc = (crc << 1) ^ CRC16_POLY;
+            else
+                crc <<= 1;
+        }
+    }
+    return crc;
+}
+
+uint16_t updateTable(uint16_t crc, const uint8_t* data, size_t length) {
+    const uint16_t* t0 = tables().t[0];
+    while (length--) {
+        crc = (uint16_t)((crc << 8) ^ t0[(crc >> 8) ^ *data++]);
+    }
+    return crc;
+}
+
+uint16_t updateSlice8(uint16_t crc, const uint8_t* data, size_t length) {
+    const CrcTables& tb = tables();
+    while (length >= 8) {
+        // CRC寄存器的高、低字节分别和前两个数据字节对齐
+        crc = tb.t[7][data[0] ^ (crc >> 8)] ^ tb.t[6][data[1] ^ (crc & 0xFF)]
+            ^ tb.t[5][data[2]] ^ tb.t[4][data[3]]
+            ^ tb.t[3][data[4]] ^ tb.t[2][data[5]]
+            ^ tb.t[1][data[6]] ^ tb.t[0][data[7]];
+        data += 8;
+        length -= 8;
+    }
+    return updateTable(crc, data, length);
+}
+
+uint16_t updateSlice16(uint16_t crc, const uint8_t* data, size_t length) {
+    const CrcTables& tb = tables();
+    while (length >= 16) {
+        crc = tb.t[15][data[0] ^ (crc >> 8)] ^ tb.t[14][data[1] ^ (crc & 0xFF)]
+            ^ tb.t[13][data[2]] ^ tb.t[12][data[3]]
+            ^ tb.t[11][data[4]] ^ tb.t[10][data[5]]
+            ^ tb.t[9][data[6]] ^ tb.t[8][data[7]]
+            ^ tb.t[7][data[8]] ^ tb.t[6][data[9]]
+            ^ tb.t[5][data[10]] ^ tb.t[4][data[11]]
+            ^ tb.t[3][data[12]] ^ tb.t[2][data[13]]
+            ^ tb.t[1][data[14]] ^ tb.t[0][data[15]];
+        data += 16;
+        length -= 16;
+    }
+    return updateTable(crc, data, length);
+}
+
+#ifdef CRC_ENGINE_HAVE_PCLMUL
+// 按大端顺序加载16字节：data[0]的最高位对应x^127
+__attribute__((target("pclmul,ssse3")))
+inline __m128i loadBE(const uint8_t* data, __m128i bswap) {
+    return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), bswap);
+}
+
+// x = hi*x^64 + lo，返回与 x*x^N 模P同余的值（k低64位为x^(N+64) mod P，高64位为x^N mod P）
+__attribute__((target("pclmul,ssse3")))
+inline __m128i fold(__m128i x, __m128i k) {
+    return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x01), _mm_clmulepi64_si128(x, k, 0x10));
+}
+
+// 用无进位乘法把长数据折叠成一个与之模P同余的128位值，再用查表法算出最终CRC
+__attribute__((target("pclmul,ssse3")))
+uint16_t updatePclmul(uint16_t crc, const uint8_t* data, size_t length) {
+    if (length < 128) {
+        return updateSlice16(crc, data, length);
+    }
+    const CrcTables& tb = tables();
+    const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m128i k128 = _mm_set_epi64x((long long)tb.k128Lo, (long long)tb.k128Hi);
+    const __m128i k512 = _mm_set_epi64x((long long)tb.k512Lo, (long long)tb.k512Hi);
+
+    // 四路并行折叠，初始CRC异或到数据的前两个字节上
+    __m128i x0 = _mm_xor_si128(loadBE(data, bswap), _mm_set_epi64x((long long)((uint64_t)crc << 48), 0));
+    __m128i x1 = loadBE(data + 16, bswap);
+    __m128i x2 = loadBE(data + 32, bswap);
+    __m128i x3 = loadBE(data + 48, bswap);
+    data += 64;
+    length -= 64;
+    while (length >= 64) {
+        x0 = _mm_xor_si128(fold(x0, k512), loadBE(data, bswap));
+        x1 = _mm_xor_si128(fold(x1, k512), loadBE(data + 16, bswap));
+        x2 = _mm_xor_si128(fold(x2, k512), loadBE(data + 32, bswap));
+        x3 = _mm_xor_si128(fold(x3, k512), loadBE(data + 48, bswap));
+        data += 64;
+        length -= 64;
+    }
+
+    // 合并四路结果，再逐个折叠剩余的16字节块
+    x1 = _mm_xor_si128(fold(x0, k128), x1);
+    x2 = _mm_xor_si128(fold(x1, k128), x2);
+    x3 = _mm_xor_si128(fold(x2, k128), x3);
+    while (length >= 16) {
+        x3 = _mm_xor_si128(fold(x3, k128), loadBE(data, bswap));
+        data += 16;
+        length -= 16;
+    }
+
+    // 折叠结果X与已处理数据模P同余，初值为0时对X计算得到的CRC即为已处理数据的CRC
+    uint8_t folded[16];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(folded), _mm_shuffle_epi8(x3, bswap));
+    crc = updateSlice16(0, folded, sizeof(folded));
+    return updateSlice16(crc, data, length);
+}
+
+bool cpuHasPclmul() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return false;
+    return (ecx & bit_PCLMUL) && (ecx & bit_SSSE3);
+}
+#endif
+
+const CrcEngine::UpdateFn g_updateFns[CRC_IMPL_COUNT] = {
+    updateBitwise,
+    updateTable,
+    updateSlice8,
+    updateSlice16,
+#ifdef CRC_ENGINE_HAVE_PCLMUL
+    updatePclmul,
+#else
+    updateSlice16,
+#endif
+};
+
+// 启动时根据cpuid选择实现
+struct CrcDispatch {
+    CrcImpl impl;
+    bool supported[CRC_IMPL_COUNT];
+
+    CrcDispatch() {
+        for (int i = 0; i < CRC_IMPL_COUNT; i++)
+            supported[i] = true;
+#ifdef CRC_ENGINE_HAVE_PCLMUL
+        supported[CRC_IMPL_PCLMUL] = cpuHasPclmul();
+#else
+        supported[CRC_IMPL_PCLMUL] = false;
+#endif
+        impl = supported[CRC_IMPL_PCLMUL] ? CRC_IMPL_PCLMUL : CRC_IMPL_SLICE16;
+        tables(); // 提前生成查表数据
+    }
+};
+
+const CrcDispatch& dispatch() {
+    static const CrcDispatch d;
+    return d;
+}
+
+// 在main之前完成选择，避免第一条消息承担初始化开销
+const CrcDispatch& g_dispatchAtStartup = dispatch();
+
+} // namespace
+
+uint16_t CrcEngine::update(uint16_t crc, const uint8_t* data, size_t length) {
+    return g_updateFns[dispatch().impl](crc, data, length);
+}
+
+uint16_t CrcEngine::update(CrcImpl impl, uint16_t crc, const uint8_t* data, size_t length) {
+    if (!isSupported(impl))
+        impl = activeImpl();
+    return g_updateFns[impl](crc, data, length);
+}
+
+CrcImpl CrcEngine::activeImpl() {
+    return dispatch().impl;
+}
+
+bool CrcEngine::isSupported(CrcImpl impl) {
+    return impl >= 0 && impl < CRC_IMPL_COUNT && dispatch().supported[impl];
+}
+
+const char* CrcEngine::implName(CrcImpl impl) {
+    switch (impl) {
+    case CRC_IMPL_BITWISE: return "bitwise";
+    case CRC_IMPL_TABLE: return "table";
+    case CRC_IMPL_SLICE8: return "slice8";
+    case CRC_IMPL_SLICE16: return "slice16";
+    case CRC_IMPL_PCLMUL: return "pclmul";
+    default: return "unknown";
+    }
+}
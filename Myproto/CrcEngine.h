@@ -0,0 +1,35 @@
+#ifndef __CRC_ENGINE_H
+#define __CRC_ENGINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// CRC-16/CCITT-FALSE计算引擎（多项式0x1021，初始值0xFFFF，不反转，无异或输出）
+// 提供多种实现，所有实现结果逐位一致；启动时通过cpuid选择当前CPU上最快的实现
+typedef enum CrcImpl
+{
+	CRC_IMPL_BITWISE = 0, //逐位计算（参考实现）
+	CRC_IMPL_TABLE = 1,   //单字节查表
+	CRC_IMPL_SLICE8 = 2,  //slicing-by-8，每次处理8字节
+	CRC_IMPL_SLICE16 = 3, //slicing-by-16，每次处理16字节
+	CRC_IMPL_PCLMUL = 4,  //x86-64 PCLMULQDQ无进位乘法折叠
+	CRC_IMPL_COUNT = 5,
+}CrcImpl;
+
+class CrcEngine
+{
+public:
+	typedef uint16_t (*UpdateFn)(uint16_t crc, const uint8_t* data, size_t length);
+
+	//使用启动时选中的实现，在crc基础上继续计算data，支持分段增量计算：
+	//update(update(crc, a), b) 与对a、b拼接后的数据计算结果相同
+	static uint16_t update(uint16_t crc, const uint8_t* data, size_t length);
+	//使用指定实现计算，当前CPU不支持该实现时退回到启动时选中的实现
+	static uint16_t update(CrcImpl impl, uint16_t crc, const uint8_t* data, size_t length);
+
+	static CrcImpl activeImpl(); //启动时选中的实现
+	static bool isSupported(CrcImpl impl); //当前CPU是否支持该实现
+	static const char* implName(CrcImpl impl);
+};
+
+#endif // __CRC_ENGINE_H
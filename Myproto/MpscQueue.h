@@ -0,0 +1,79 @@
+#ifndef __MPSC_QUEUE_H
+#define __MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MPSC_CPU_RELAX() _mm_pause()
+#else
+#define MPSC_CPU_RELAX() std::atomic_signal_fence(std::memory_order_seq_cst)
+#endif
+
+// 无锁多生产者单消费者队列（Vyukov的链表MPSC队列）
+// - 生产者push只有一次原子交换和一次store，不加锁、不等待其他生产者
+// - 消费者pop不与生产者竞争，只读写自己的尾指针
+// - 链表头是一个哑节点，出队时上一个哑节点被释放，取出的节点成为新的哑节点
+// push可在任意线程调用，pop只能由唯一的消费者线程调用；T需要可默认构造和移动
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() : head_(new Node()) { tail_ = head_.load(std::memory_order_relaxed); }
+    ~MpscQueue() {
+        T value;
+        while (pop(value)) {
+        }
+        delete tail_;
+    }
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // 任意线程调用
+    void push(T value) {
+        Node* node = new Node(std::move(value));
+        Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+        // 交换和链接之间其他线程看到的是断开的链表，消费者在pop中等待链接完成
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // 只能由消费者线程调用，队列为空时返回false
+    bool pop(T& value) {
+        Node* tail = tail_;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            if (head_.load(std::memory_order_acquire) == tail) {
+                return false;
+            }
+            // 生产者已经交换了头指针但还没有链接，只差一条store，短暂自旋
+            while (!(next = tail->next.load(std::memory_order_acquire))) {
+                MPSC_CPU_RELAX();
+            }
+        }
+        value = std::move(next->value);
+        tail_ = next;
+        delete tail;
+        return true;
+    }
+
+    // 只能由消费者线程调用
+    bool empty() const {
+        return tail_->next.load(std::memory_order_acquire) == nullptr &&
+               head_.load(std::memory_order_acquire) == tail_;
+    }
+
+private:
+    struct Node {
+        Node() : next(nullptr) {}
+        explicit Node(T&& v) : next(nullptr), value(std::move(v)) {}
+        std::atomic<Node*> next;
+        T value;
+    };
+
+    // head_被生产者频繁交换，tail_只由消费者读写，填充到不同的缓存行（C++11的new不保证alignas(64)）
+    std::atomic<Node*> head_; // 最近入队的节点
+    char padHead_[64 - sizeof(std::atomic<Node*>)];
+    Node* tail_;              // 哑节点
+};
+
+#endif // __MPSC_QUEUE_H
@@ -0,0 +1,102 @@
+#ifndef __MY_PROTO_STRUCT_H
+#define __MY_PROTO_STRUCT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <memory>
+#include <stdexcept>
+#include "myproto.h"
+
+// 由schema生成的结构体消息体（MY_PROTO_CODEC_STRUCT）使用的线路格式辅助函数
+//
+// 消息体布局（多字节字段一律小端）：
+//   [0, 4)            schema指纹，收发双方的结构定义不一致时解码失败
+//   [4, kFixedSize)   定长字段按schema中的顺序紧密排列，偏移量由生成器算好写成constexpr常量；
+//                     string字段在定长区只占4字节长度
+//   [kFixedSize, len) string字段的内容按schema中的顺序依次排列
+namespace myproto_struct {
+
+const size_t SCHEMA_ID_SIZE = 4; // 消息体开头的schema指纹长度
+
+template<size_t N> struct UIntOf;
+template<> struct UIntOf<1> { typedef uint8_t type; };
+template<> struct UIntOf<2> { typedef uint16_t type; };
+template<> struct UIntOf<4> { typedef uint32_t type; };
+template<> struct UIntOf<8> { typedef uint64_t type; };
+
+inline uint8_t toLittle(uint8_t v) { return v; }
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+inline uint16_t toLittle(uint16_t v) { return __builtin_bswap16(v); }
+inline uint32_t toLittle(uint32_t v) { return __builtin_bswap32(v); }
+inline uint64_t toLittle(uint64_t v) { return __builtin_bswap64(v); }
+#else
+inline uint16_t toLittle(uint16_t v) { return v; }
+inline uint32_t toLittle(uint32_t v) { return v; }
+inline uint64_t toLittle(uint64_t v) { return v; }
+#endif
+
+// 按小端写入一个定长字段（整数、浮点数），p不要求对齐
+template<typename T>
+inline void put(uint8_t* p, T v) {
+    typename UIntOf<sizeof(T)>::type u;
+    memcpy(&u, &v, sizeof(u));
+    u = toLittle(u);
+    memcpy(p, &u, sizeof(u));
+}
+
+// 按小端读取一个定长字段
+template<typename T>
+inline T get(const uint8_t* p) {
+    typename UIntOf<sizeof(T)>::type u;
+    memcpy(&u, p, sizeof(u));
+    u = toLittle(u);
+    T v;
+    memcpy(&v, &u, sizeof(v));
+    return v;
+}
+
+template<>
+inline void put<bool>(uint8_t* p, bool v) { *p = v ? 1 : 0; }
+
+template<>
+inline bool get<bool>(const uint8_t* p) { return *p != 0; }
+
+// 把生成的结构体编码成可以直接发送的消息：消息体写入一块共享Buffer，作为原始消息体挂在消息上，
+// 编码帧时原样拷贝，不经过JSON；字符串字段超长时返回false
+template<typename T>
+bool makeMsg(const T& value, MyProtoMsg& msg) {
+    std::shared_ptr<muduo::net::Buffer> body = std::make_shared<muduo::net::Buffer>();
+    if (!value.encode(body.get())) {
+        std::cerr << "Struct encode failed: string field of " << T::kName << " exceeds "
+                  << MY_PROTO_MAX_JSON_STRING_LEN << " bytes" << std::endl;
+        return false;
+    }
+
+    msg.head.version = 1;
+    msg.head.server = T::kServerId;
+    msg.head.type = MY_PROTO_TYPE_DATA;
+    msg.head.codec = MY_PROTO_CODEC_STRUCT;
+    msg.raw.owner = body;
+    msg.raw.data = body->peek();
+    msg.raw.len = body->readableBytes();
+    msg.raw.codec = MY_PROTO_CODEC_STRUCT;
+    return true;
+}
+
+// 从收到的消息中解码结构体：结构体编码直接按定长布局读取，其他编码退回到JSON
+template<typename T>
+bool decodeMsg(MyProtoMsg& msg, T& out) {
+    if (msg.head.codec == MY_PROTO_CODEC_STRUCT) {
+        return msg.hasRawBody() && T::decode(msg.raw.data, msg.raw.len, out);
+    }
+    try {
+        return T::fromJson(msg.getBody(), out);
+    } catch (const std::exception& e) {
+        std::cerr << "Struct decode exception: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+} // namespace myproto_struct
+
+#endif // __MY_PROTO_STRUCT_H
@@ -0,0 +1,190 @@
+#ifndef __PENDING_RING_H
+#define __PENDING_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include "SequenceWindow.h"
+#include "TimingWheel.h"
+
+// 按序列号组织的待确认消息环形缓冲区，第seq条消息放在下标seq & (capacity-1)的槽中
+// - base_：最早未确认的序列号（环的头），next_：已登记的最大序列号+1（环的尾）
+// - 查找、插入、删除都是数组下标访问；累计确认N时从头释放到N，只移动头指针，开销与释放的条数成正比
+// - 序列号都在IO线程分配，按分配顺序登记；回绕时跳过的0和中途删除（确认、放弃）的消息留空槽
+// Entry必须继承TimerNode：扩容搬移时把在时间轮上的节点按原到期时间重新挂到时间轮上
+// 非线程安全，只在连接所属的IO线程中使用
+template <typename Entry>
+class PendingRing {
+public:
+    PendingRing() : capacity_(0), base_(0), next_(0), size_(0) {}
+    PendingRing(const PendingRing&) = delete;
+    PendingRing& operator=(const PendingRing&) = delete;
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    // 最早未确认的序列号，环为空时无意义
+    uint32_t baseSequence() const { return base_; }
+    // 已登记的最大序列号+1
+    uint32_t endSequence() const { return next_; }
+
+    // 登记序列号seq，返回对应的槽；seq已在环中时返回已有的槽
+    // 早于环头（已经确认过）或者与环头相距超过MAX_CAPACITY时返回nullptr
+    Entry* insert(uint32_t seq) {
+        if (size_ == 0) {
+            // 环为空时以新序列号为起点，空槽无需清理
+            base_ = next_ = seq;
+        } else if (seqBefore(seq, base_)) {
+            return nullptr;
+        }
+        uint32_t end = seqBefore(seq, next_) ? next_ : seq + 1;
+        if (end - base_ > MAX_CAPACITY) {
+            return nullptr; // 未确认的跨度过大
+        }
+        reserve(end - base_);
+        next_ = end;
+        Slot& slot = slots_[seq & (capacity_ - 1)];
+        if (!slot.used) {
+            slot.used = true;
+            size_++;
+        }
+        return &slot.entry;
+    }
+
+    // 查找序列号seq对应的消息，不在环中时返回nullptr
+    Entry* find(uint32_t seq) {
+        if (!contains(seq)) {
+            return nullptr;
+        }
+        return &slots_[seq & (capacity_ - 1)].entry;
+    }
+
+    bool contains(uint32_t seq) const {
+        if (size_ == 0 || seqBefore(seq, base_) || !seqBefore(seq, next_)) {
+            return false;
+        }
+        return slots_[seq & (capacity_ - 1)].used;
+    }
+
+    // 删除单条消息（同时取消其定时器），删除的是环头时把头指针移到下一条未确认的消息
+    bool erase(uint32_t seq) {
+        if (!contains(seq)) {
+            return false;
+        }
+        release(slots_[seq & (capacity_ - 1)]);
+        if (seq == base_) {
+            advanceBase();
+        }
+        return true;
+    }
+
+    // 累计确认：释放所有不晚于seq的消息，每释放一条前调用一次onRelease(entry)，返回释放的条数
+    template <typename Callback>
+    size_t releaseUpTo(uint32_t seq, Callback onRelease) {
+        if (size_ == 0 || seqBefore(seq, base_)) {
+            return 0;
+        }
+        if (!seqBefore(seq, next_)) {
+            seq = next_ - 1; // 确认号超出已发送范围时只释放已登记的部分
+        }
+        size_t released = 0;
+        for (uint32_t s = base_; seqBeforeOrEqual(s, seq); s++) {
+            Slot& slot = slots_[s & (capacity_ - 1)];
+            if (slot.used) {
+                onRelease(slot.entry);
+                release(slot);
+                released++;
+            }
+        }
+        base_ = seq + 1;
+        advanceBase();
+        return released;
+    }
+
+    size_t releaseUpTo(uint32_t seq) {
+        return releaseUpTo(seq, [](Entry&) {});
+    }
+
+    // 按序列号从小到大遍历未确认的消息
+    template <typename Callback>
+    void forEach(Callback cb) {
+        for (uint32_t s = base_; size_ > 0 && seqBefore(s, next_); s++) {
+            Slot& slot = slots_[s & (capacity_ - 1)];
+            if (slot.used) {
+                cb(s, slot.entry);
+            }
+        }
+    }
+
+    void clear() {
+        for (uint32_t i = 0; i < capacity_; i++) {
+            if (slots_[i].used) {
+                release(slots_[i]);
+            }
+        }
+        base_ = next_;
+    }
+
+private:
+    static const uint32_t MIN_CAPACITY = 16;
+    static const uint32_t MAX_CAPACITY = 1u << 20;
+
+    struct Slot {
+        Entry entry;
+        bool used = false;
+    };
+
+    void release(Slot& slot) {
+        slot.entry.cancel();
+        slot.entry = Entry();
+        slot.used = false;
+        size_--;
+    }
+
+    // 头指针跳过已经释放的空槽，直到下一条未确认的消息
+    void advanceBase() {
+        if (size_ == 0) {
+            base_ = next_;
+            return;
+        }
+        while (!slots_[base_ & (capacity_ - 1)].used) {
+            base_++;
+        }
+    }
+
+    // 保证环能容纳span个连续序列号，容量按2的幂增长；必须在修改next_之前调用
+    void reserve(uint32_t span) {
+        if (span <= capacity_) {
+            return;
+        }
+        uint32_t capacity = capacity_ ? capacity_ : MIN_CAPACITY;
+        while (capacity < span) {
+            capacity <<= 1;
+        }
+        std::unique_ptr<Slot[]> slots(new Slot[capacity]);
+        for (uint32_t s = base_; capacity_ > 0 && seqBefore(s, next_); s++) {
+            Slot& from = slots_[s & (capacity_ - 1)];
+            if (!from.used) {
+                continue;
+            }
+            Slot& to = slots[s & (capacity - 1)];
+            to.entry = from.entry; // TimerNode的拷贝不带链接关系，下面重新挂到时间轮
+            to.used = true;
+            TimingWheel* wheel = from.entry.wheel;
+            uint64_t expire = from.entry.expire;
+            from.entry.cancel();
+            if (wheel) {
+                wheel->add(&to.entry, expire);
+            }
+        }
+        slots_.swap(slots);
+        capacity_ = capacity;
+    }
+
+    std::unique_ptr<Slot[]> slots_;
+    uint32_t capacity_; // 槽数，2的幂
+    uint32_t base_;     // 最早未确认的序列号
+    uint32_t next_;     // 已登记的最大序列号+1
+    size_t size_;       // 已登记的消息数
+};
+
+#endif // __PENDING_RING_H
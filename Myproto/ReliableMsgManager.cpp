@@ -1,13 +1,76 @@
 #include "ReliableMsgManager.h"
 #include "muduo/net/TcpConnection.h"
+#include "muduo/net/EventLoop.h"
 #include "myproto.h"
+#include <arpa/inet.h>
 
-ReliableMsgManager::ReliableMsgManager() : nextSequence_(1) {
+namespace {
+// 进程内所有管理器共用的时间轮零点，投递期限等tick值在管理器之间可以直接比较
+std::chrono::steady_clock::time_point tickEpoch() {
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return epoch;
+}
+}
+
+ReliableMsgManager::ReliableMsgManager(muduo::net::EventLoop* loop)
+    : loop_(loop),
+      alive_(std::make_shared<bool>(true)),
+      epoch_(tickEpoch()),
+      retransmitWheel_(0),
+      ackWheel_(0),
+      delayedAckMs_(DELAYED_ACK_MS),
+      delayedAckMessages_(DELAYED_ACK_MESSAGES),
+      armedTick_(0) {
 }
 
 ReliableMsgManager::~ReliableMsgManager() {
 }
 
+// 为新连接创建可靠性状态，连接上下文和连接表共同持有
+ReliableConnStatePtr ReliableMsgManager::addConnection(const muduo::net::TcpConnectionPtr& conn) {
+    ReliableConnStatePtr state = std::make_shared<ReliableConnState>();
+    state->conn = conn;
+    state->ackTimer.state = state.get();
+    registerConnection(state);
+    return state;
+}
+
+void ReliableMsgManager::registerConnection(const ReliableConnStatePtr& state) {
+    // 优先复用已关闭连接留下的编号，连接表保持紧凑
+    if (!freeIds_.empty()) {
+        state->id = freeIds_.back();
+        freeIds_.pop_back();
+        connections_[state->id] = state;
+    } else {
+        state->id = static_cast<uint32_t>(connections_.size());
+        connections_.push_back(state);
+    }
+}
+
+ReliableConnState* ReliableMsgManager::connection(uint32_t id) const {
+    return id < connections_.size() ? connections_[id].get() : nullptr;
+}
+
+void ReliableMsgManager::setDelayedAck(int delayMs, uint32_t maxMessages) {
+    delayedAckMs_ = delayMs > 0 ? delayMs : 0;
+    delayedAckMessages_ = maxMessages > 0 ? maxMessages : 1;
+}
+
+void ReliableMsgManager::setRetryPolicy(uint16_t server, const RetryPolicy& policy) {
+    retryPolicies_[server] = policy;
+}
+
+// 服务号从帧头中读取，没有单独配置的服务时不必解析
+const RetryPolicy& ReliableMsgManager::retryPolicy(const MyProtoFramePtr& frame) const {
+    if (retryPolicies_.empty()) {
+        return defaultRetryPolicy_;
+    }
+    uint16_t server = 0;
+    memcpy(&server, frame->data() + SERVER_OFFSET, sizeof(server));
+    auto it = retryPolicies_.find(ntohs(server));
+    return it != retryPolicies_.end() ? it->second : defaultRetryPolicy_;
+}
+
 /**
  * 发送可靠消息的核心方法
  * @param conn TCP连接指针，用于发送消息
@@ -15,140 +78,447 @@ ReliableMsgManager::~ReliableMsgManager() {
  * @return 返回分配的唯一序列号
  */
 // 修改sendReliableMessage方法，添加更多调试输出
-uint32_t ReliableMsgManager::sendReliableMessage(const muduo::net::TcpConnectionPtr& conn, const MyProtoMsg& msg) {
+uint32_t ReliableMsgManager::sendReliableMessage(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, const MyProtoMsg& msg,
+                                                 const DeliveryCallbacksPtr& callbacks) {
     if (!conn || !conn->connected()) {
         std::cout << "Error: Connection not valid or disconnected" << std::endl;
         return 0;
     }
+    // 先确认能发出再分配序列号，拒绝的消息不占用序列号
+    if (state.sendQueue.size() >= SEND_QUEUE_LIMIT) {
+        std::cout << "Error: Send queue full, dropping message" << std::endl;
+        return 0;
+    }
 
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    // 获取连接名称
-    std::string connName = conn->name();
-    
-    // 分配唯一序列号
-    uint32_t sequence = nextSequence_++;
+    uint32_t sequence = state.allocateSequence();
+    // 只编码一次，待确认列表保存编码结果，不再保留消息副本
+    MyProtoFramePtr frame = encodeDataFrame(msg, sequence);
+    if (!frame) {
+        std::cout << "Failed to encode message" << std::endl;
+        state.nextSequence = sequence; // 退回没有用掉的序列号
+        return 0;
+    }
+    sendReliableFrame(conn, state, sequence, frame, callbacks);
+    return sequence;
+}
+
+void ReliableMsgManager::sendReliableFrame(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, uint32_t sequence,
+                                           const MyProtoFramePtr& frame, const DeliveryCallbacksPtr& callbacks) {
+    // 窗口已满或前面还有排队的帧时进入发送队列，保证按提交顺序发出
+    if (!state.sendQueue.empty() || !windowAllows(state, sequence, frame->size())) {
+        state.sendQueue.push_back(QueuedFrame{sequence, frame, callbacks});
+        if (!state.backpressured && state.sendQueue.size() >= SEND_QUEUE_HIGH_WATER) {
+            state.backpressured = true;
+            if (backpressureCallback_) {
+                backpressureCallback_(conn, true);
+            }
+        }
+        return;
+    }
     
-    // 保存消息到待确认列表
-    PendingMessage pendingMsg;
-    pendingMsg.msg = msg;
-    pendingMsg.msg.head.sequence = sequence; // 设置消息序列号
-    // 关键修改：显式设置版本号为1（系统支持的版本）
-    pendingMsg.msg.head.version = 1;
-    pendingMsg.msg.head.type = 0; // 数据消息类型
+    transmit(conn, state, sequence, frame, callbacks);
+}
 
+// 飞行中的消息数、字节数和序列号跨度都在限制内才允许发送；没有飞行中的消息时总是允许，保证大消息也能发出
+bool ReliableMsgManager::windowAllows(const ReliableConnState& state, uint32_t sequence, size_t bytes) const {
+    const ConnectionStatus& status = state.status;
+    if (state.pendingMessages.empty()) {
+        return true;
+    }
+    if (status.inflightMessages >= status.congestionWindow) {
+        return false;
+    }
+    if (status.inflightBytes + bytes > MAX_INFLIGHT_BYTES) {
+        return false;
+    }
+    return sequence - state.pendingMessages.baseSequence() < static_cast<uint32_t>(MAX_CONGESTION_WINDOW);
+}
+
+void ReliableMsgManager::transmit(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, uint32_t sequence,
+                                  const MyProtoFramePtr& frame, const DeliveryCallbacksPtr& callbacks) {
+    // 保存帧到待确认列表
+    PendingMessage* slot = state.pendingMessages.insert(sequence);
+    if (!slot) {
+        std::cout << "Error: Sequence " << sequence << " out of pending window" << std::endl;
+        recordFailed(callbacks, sequence, DELIVERY_QUEUE_FULL);
+        return;
+    }
+    PendingMessage& pendingMsg = *slot;
+    if (!pendingMsg.frame) {
+        state.status.inflightMessages++;
+        state.status.inflightBytes += frame->size();
+    }
+    pendingMsg.sequence = sequence;
+    pendingMsg.frame = frame;
     pendingMsg.sendTime = std::chrono::steady_clock::now();
     pendingMsg.retryCount = 0;
+    pendingMsg.retransmitted = false;
+    pendingMsg.state = &state;
+    pendingMsg.callbacks = callbacks;
+    const RetryPolicy& policy = retryPolicy(frame);
+    pendingMsg.maxRetries = policy.maxRetries;
+    pendingMsg.deadline = policy.deadlineMs > 0 ? nowTick() + static_cast<uint64_t>(policy.deadlineMs) / RETRANSMIT_TICK_MS : 0;
     
-    pendingMessages_[connName][sequence] = pendingMsg;
-    
-    // 保存连接指针到映射中（使用weak_ptr避免循环引用）
-    connectionMap_[connName] = std::weak_ptr<muduo::net::TcpConnection>(conn);
-    
-    // 编码并发送消息
+    sendDataFrame(conn, state, frame);
+    // 按连接当前的超时时间挂到重传时间轮上，收到确认时随消息一起删除
+    scheduleRetransmit(state, pendingMsg);
+}
+
+// 一次确认可能打开多条消息的窗口，没有在批量发送时这些帧合并成一次写
+void ReliableMsgManager::flushSendQueue(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state) {
+    bool ownBatch = !batchConn_ && !state.sendQueue.empty();
+    if (ownBatch) {
+        beginBatch(conn);
+    }
+    while (!state.sendQueue.empty()) {
+        const QueuedFrame& next = state.sendQueue.front();
+        if (!windowAllows(state, next.sequence, next.frame->size())) {
+            break;
+        }
+        transmit(conn, state, next.sequence, next.frame, next.callbacks);
+        state.sendQueue.pop_front();
+    }
+    if (ownBatch) {
+        endBatch();
+    }
+    if (state.backpressured && state.sendQueue.size() <= SEND_QUEUE_LOW_WATER) {
+        state.backpressured = false;
+        if (backpressureCallback_) {
+            backpressureCallback_(conn, false);
+        }
+    }
+}
+
+bool ReliableMsgManager::releasePending(ReliableConnState& state, uint32_t sequence) {
+    PendingMessage* pending = state.pendingMessages.find(sequence);
+    if (!pending) {
+        return false;
+    }
+    recordAcked(*pending, std::chrono::steady_clock::now());
+    state.status.inflightMessages--;
+    state.status.inflightBytes -= pending->frame->size();
+    state.pendingMessages.erase(sequence);
+    return true;
+}
+
+void ReliableMsgManager::abandonPending(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, uint32_t sequence,
+                                        DeliveryFailure reason) {
+    PendingMessage* pending = state.pendingMessages.find(sequence);
+    if (!pending) {
+        return;
+    }
+    recordFailed(pending->callbacks, sequence, reason);
+    state.status.inflightMessages--;
+    state.status.inflightBytes -= pending->frame->size();
+    state.pendingMessages.erase(sequence);
+    if (conn && conn->connected()) {
+        flushSendQueue(conn, state);
+    }
+}
+
+void ReliableMsgManager::recordAcked(const PendingMessage& pending, std::chrono::steady_clock::time_point now) {
+    if (!pending.callbacks || !pending.callbacks->onAcked) {
+        return;
+    }
+    int64_t latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(now - pending.sendTime).count();
+    deliveryEvents_.push_back(DeliveryEvent{pending.callbacks, pending.sequence, true, latencyUs, DELIVERY_MAX_RETRIES});
+}
+
+void ReliableMsgManager::recordFailed(const DeliveryCallbacksPtr& callbacks, uint32_t sequence, DeliveryFailure reason) {
+    if (!callbacks || !callbacks->onFailed) {
+        return;
+    }
+    deliveryEvents_.push_back(DeliveryEvent{callbacks, sequence, false, 0, reason});
+}
+
+// 回调中发送的消息又可能产生新的投递结果，交换出来逐批执行直到没有新的结果
+void ReliableMsgManager::notifyDelivery() {
+    while (!deliveryEvents_.empty()) {
+        std::vector<DeliveryEvent> events;
+        events.swap(deliveryEvents_);
+        for (const DeliveryEvent& event : events) {
+            try {
+                if (event.acked) {
+                    event.callbacks->onAcked(event.sequence, event.latencyUs);
+                } else {
+                    event.callbacks->onFailed(event.sequence, event.reason);
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Error in delivery callback, sequence: " << event.sequence << ", " << e.what() << std::endl;
+            }
+        }
+    }
+}
+
+// AIMD：慢启动阶段每确认一条窗口加1，拥塞避免阶段每确认一个窗口的消息窗口加1
+void ReliableMsgManager::onAcked(ReliableConnState& state, size_t acked) {
+    ConnectionStatus& status = state.status;
+    if (status.inRecovery) {
+        if (state.pendingMessages.empty() || seqAfter(state.pendingMessages.baseSequence(), status.recoverySequence)) {
+            status.inRecovery = false; // 丢包时已发出的消息都已确认，恢复结束
+        } else if (!status.recoveryByTimeout) {
+            return; // 快速恢复期间窗口保持不变
+        }
+    }
+    for (size_t i = 0; i < acked && status.congestionWindow < MAX_CONGESTION_WINDOW; i++) {
+        if (status.congestionWindow < status.slowStartThreshold) {
+            status.congestionWindow++;
+        } else if (++status.ackedInWindow >= status.congestionWindow) {
+            status.ackedInWindow = 0;
+            status.congestionWindow++;
+        }
+    }
+}
+
+void ReliableMsgManager::onLoss(ReliableConnState& state, uint32_t sequence, bool timeout) {
+    ConnectionStatus& status = state.status;
+    // 同一窗口内的多个丢包只减一次窗口；快速恢复中又发生超时时仍按超时处理
+    if (status.inRecovery && seqBeforeOrEqual(sequence, status.recoverySequence) && (status.recoveryByTimeout || !timeout)) {
+        return;
+    }
+    status.slowStartThreshold = std::max(status.congestionWindow / 2, MIN_CONGESTION_WINDOW);
+    status.congestionWindow = timeout ? MIN_CONGESTION_WINDOW : status.slowStartThreshold;
+    status.ackedInWindow = 0;
+    status.inRecovery = true;
+    status.recoveryByTimeout = timeout;
+    status.recoverySequence = state.pendingMessages.endSequence() - 1;
+}
+
+MyProtoFramePtr ReliableMsgManager::encodeDataFrame(const MyProtoMsg& msg, uint32_t sequence) {
+    MyProtoHead head = msg.head;
+    head.sequence = sequence; // 设置消息序列号
+    // 关键修改：显式设置版本号为1（系统支持的版本）
+    head.version = 1;
+    head.type = MY_PROTO_TYPE_DATA; // 数据消息类型
+    // 预留捎带确认号，发送时再填入当时的累计确认号
+    head.flags |= MY_PROTO_FLAG_PIGGYBACK_ACK;
+    head.ack = 0;
     MyProtoEncode encoder;
-    uint32_t len = 0;
-    uint8_t* data = encoder.encode(const_cast<MyProtoMsg*>(&pendingMsg.msg), len);
-    
-    if (data && len > 0) {
-        conn->send(data, len);
-        std::cout << "Message encoded and sent successfully, length: " << len << " bytes" << std::endl;
-        delete[] data;
-    } else {
-        std::cout << "Failed to encode message" << std::endl;
+    return encoder.encodeFrame(msg, head);
+}
+
+uint32_t ReliableMsgManager::allocateTicket() {
+    static std::atomic<uint32_t> nextTicket(1);
+    uint32_t ticket = nextTicket.fetch_add(1, std::memory_order_relaxed);
+    if (ticket == 0) {
+        ticket = nextTicket.fetch_add(1, std::memory_order_relaxed); // 回绕后跳过0
     }
-    
-    return sequence;
+    return ticket;
+}
+
+bool ReliableMsgManager::prepareBody(const MyProtoMsg& msg, MyProtoMsg& out) {
+    out.head = msg.head;
+    if (msg.hasRawBody() && msg.raw.codec == msg.head.codec) {
+        out.raw = msg.raw; // 原始字节可以直接发送，共享同一份
+        return true;
+    }
+    std::shared_ptr<muduo::net::Buffer> bytes = std::make_shared<muduo::net::Buffer>();
+    try {
+        if (msg.hasRawBody()) {
+            json body;
+            if (!parseBody(msg.raw.codec, msg.raw.data, msg.raw.len, body)) {
+                return false;
+            }
+            serializeBody(msg.head.codec, body, bytes.get());
+        } else {
+            serializeBody(msg.head.codec, msg.body, bytes.get());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Encode exception: " << e.what() << std::endl;
+        return false;
+    }
+    out.raw.owner = bytes;
+    out.raw.data = bytes->peek();
+    out.raw.len = bytes->readableBytes();
+    out.raw.codec = msg.head.codec;
+    return true;
+}
+
+DeliveryCallbacksPtr ReliableMsgManager::ticketCallbacks(uint32_t ticket, const DeliveryAckedCallback& onAcked,
+                                                         const DeliveryFailedCallback& onFailed) {
+    if (!onAcked && !onFailed) {
+        return DeliveryCallbacksPtr();
+    }
+    DeliveryCallbacksPtr callbacks = std::make_shared<DeliveryCallbacks>();
+    if (onAcked) {
+        callbacks->onAcked = [onAcked, ticket](uint32_t, int64_t latencyUs) { onAcked(ticket, latencyUs); };
+    }
+    if (onFailed) {
+        callbacks->onFailed = [onFailed, ticket](uint32_t, DeliveryFailure reason) { onFailed(ticket, reason); };
+    }
+    return callbacks;
 }
 
 // 处理接收到的确认消息
-void ReliableMsgManager::processAckMessage(const muduo::net::TcpConnectionPtr& conn, const MyProtoMsg& msg) {
+void ReliableMsgManager::processAckMessage(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, const MyProtoMsg& msg) {
     if (!conn || !conn->connected()) {
         return;
     }
     
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    std::string connName = conn->name();
     uint32_t sequence = msg.head.sequence;
+    
+    // 查找并移除已确认的消息，RTT取被确认的那条消息自己的发送时间
+    sampleRTT(state, sequence);
+    size_t released = 0;
+    if(msg.head.type==MY_PROTO_TYPE_ACK)
+    {
+        // 单条确认：只移除对应序列号的消息
+        released = releasePending(state, sequence) ? 1 : 0;
+    }
+    else if(msg.head.type==MY_PROTO_TYPE_BATCH_ACK||msg.head.type==MY_PROTO_TYPE_SACK)
+    {
+        // 累计确认：不晚于最大已确认序列号的消息全部释放，只移动环头
+        released = releaseCumulative(state, sequence);
+        if(msg.head.type==MY_PROTO_TYPE_SACK)
+        {
+            // 选择确认：再处理累计确认号之后已收到的区间
+            released += processSackRanges(conn, state, msg);
+        }
+    }
+    afterAcked(conn, state, released);
+    notifyDelivery();
+}
+
+void ReliableMsgManager::processPiggybackAck(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, uint32_t ack) {
+    if (ack == 0 || state.pendingMessages.empty()) {
+        return;
+    }
+    sampleRTT(state, ack);
+    afterAcked(conn, state, releaseCumulative(state, ack));
+    notifyDelivery();
+}
+
+size_t ReliableMsgManager::releaseCumulative(ReliableConnState& state, uint32_t sequence) {
+    ConnectionStatus& status = state.status;
     auto now = std::chrono::steady_clock::now();
+    return state.pendingMessages.releaseUpTo(sequence, [this, &status, now](PendingMessage& entry) {
+        recordAcked(entry, now);
+        status.inflightMessages--;
+        status.inflightBytes -= entry.frame->size();
+    });
+}
+
+void ReliableMsgManager::afterAcked(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, size_t acked) {
+    if (acked > 0) {
+        // 窗口随确认增大，腾出的空间用来发送排队的帧
+        onAcked(state, acked);
+        flushSendQueue(conn, state);
+    }
+}
+
+size_t ReliableMsgManager::processSackRanges(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, const MyProtoMsg& msg) {
+    const uint8_t* payload = reinterpret_cast<const uint8_t*>(msg.raw.data);
+    if (!payload || msg.raw.len < 1) {
+        return 0;
+    }
+    uint32_t count = payload[0];
+    if (count > SACK_MAX_RANGES || msg.raw.len < 1 + count * SACK_RANGE_SIZE) {
+        std::cout << "[ReliableManager] Malformed SACK frame, ranges: " << count << ", length: " << msg.raw.len << std::endl;
+        return 0;
+    }
     
-    // 查找并移除已确认的消息
-    auto connIt = pendingMessages_.find(connName);
-    if (connIt != pendingMessages_.end()) {
-        auto msgIt = connIt->second.find(sequence);
-        if (msgIt != connIt->second.end()) {
-            if(msg.head.type==2)
-            {
-                uint32_t maxSequence=msg.head.sequence;
-                for(auto it=connIt->second.begin();it!=connIt->second.end();)
-                {
-                    if(it->first<=maxSequence)
-                    {
-                        auto rtt=chrono::duration_cast<chrono::milliseconds>(now-msgIt->second.sendTime).count();
-                        // 更新连接的RTT统计
-                        ConnectionStatus& status = connectionStatusMap_[connName];
-                        if(status.avgRTT==0){
-                            // 首次测量
-                            status.avgRTT = rtt;
-                            status.rttVar = rtt / 2;
-                        }else{
-                            // 平滑更新RTT和方差
-                            int delta=abs(rtt-status.avgRTT);
-                            status.rttVar = (3 * status.rttVar + delta) / 4;
-                            status.avgRTT = (7 * status.avgRTT + rtt) / 8;
-                        }
-                        // 计算新的超时时间
-                        status.timeoutInterval = calculateTimeout(status.avgRTT, status.rttVar);
-                        it=connIt->second.erase(it);
-                    }
-                    else
-                    {
-                       auto rtt=chrono::duration_cast<chrono::milliseconds>(now-msgIt->second.sendTime).count();
-                        // 更新连接的RTT统计
-                        ConnectionStatus& status = connectionStatusMap_[connName];
-                        if(status.avgRTT==0){
-                            // 首次测量
-                            status.avgRTT = rtt;
-                            status.rttVar = rtt / 2;
-                        }else{
-                            // 平滑更新RTT和方差
-                            int delta=abs(rtt-status.avgRTT);
-                            status.rttVar = (3 * status.rttVar + delta) / 4;
-                            status.avgRTT = (7 * status.avgRTT + rtt) / 8;
-                        }
-                        // 计算新的超时时间
-                        status.timeoutInterval = calculateTimeout(status.avgRTT, status.rttVar);
-                        // 消息已确认，从待确认列表中删除
-                        connIt->second.erase(msgIt); 
-                    }
-                }
-            }
-            
-            
-            // 如果该连接没有待确认消息，清理连接映射
-            if (connIt->second.empty()) {
-                pendingMessages_.erase(connIt);
+    auto& pending = state.pendingMessages;
+    if (pending.empty()) {
+        return 0;
+    }
+    // 区间来自对端，先截到待确认列表的范围[low, high)内：范围之外没有要释放的消息，也不应影响下面的空洞扫描
+    uint32_t low = pending.baseSequence();
+    uint32_t high = pending.endSequence();
+    uint32_t base = msg.head.sequence + 1;
+    uint32_t highest = 0;
+    bool sacked = false;
+    size_t released = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t* range = payload + 1 + i * SACK_RANGE_SIZE;
+        uint16_t offset = 0, length = 0;
+        memcpy(&offset, range, sizeof(offset));
+        memcpy(&length, range + 2, sizeof(length));
+        uint32_t begin = base + ntohs(offset);
+        uint32_t end = begin + ntohs(length);
+        if (seqBefore(begin, low)) {
+            begin = low;
+        }
+        if (seqAfter(end, high)) {
+            end = high;
+        }
+        if (!seqBefore(begin, end)) {
+            continue;
+        }
+        for (uint32_t s = begin; s != end; s++) {
+            if (releasePending(state, s)) {
+                released++;
             }
         }
+        if (!sacked || seqAfter(end - 1, highest)) {
+            highest = end - 1;
+            sacked = true;
+        }
+    }
+    if (!sacked || pending.empty()) {
+        return released;
+    }
+    
+    // 早于最高已收序列号却仍未确认的消息就是空洞，被越过足够多次后立即重传，不再等整个超时时间
+    for (uint32_t s = pending.baseSequence(); seqBefore(s, highest); s++) {
+        PendingMessage* hole = pending.find(s);
+        if (!hole || hole->fastRetransmitted) {
+            continue;
+        }
+        if (++hole->sackMisses >= FAST_RETRANSMIT_THRESHOLD) {
+            hole->fastRetransmitted = true;
+            std::cout << "Fast retransmit, sequence: " << s << std::endl;
+            onLoss(state, s, false);
+            retransmit(conn, state, *hole);
+        }
+    }
+    return released;
+}
+
+// Karn算法：重传过的消息无法区分确认对应哪一次发送，不参与采样
+void ReliableMsgManager::sampleRTT(ReliableConnState& state, uint32_t sequence) {
+    PendingMessage* acked = state.pendingMessages.find(sequence);
+    if (!acked || acked->retransmitted) {
+        return;
+    }
+    auto rtt = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - acked->sendTime).count();
+    updateRTT(state.status, static_cast<int>(rtt));
+}
+
+// 用一次RTT采样平滑更新RTT和方差，并重新计算超时时间（RFC 6298第2节）
+void ReliableMsgManager::updateRTT(ConnectionStatus& status, int rtt) {
+    status.lastRTT = rtt;
+    if(status.avgRTT==0&&status.rttVar==0){
+        // 首次测量
+        status.avgRTT = rtt;
+        status.rttVar = rtt / 2;
+    }else{
+        // 先用旧的SRTT更新偏差，再平滑更新RTT
+        int delta=abs(rtt-status.avgRTT);
+        status.rttVar = (3 * status.rttVar + delta) / 4;
+        status.avgRTT = (7 * status.avgRTT + rtt) / 8;
     }
+    // 计算新的超时时间，有效采样说明链路已恢复，退避清零
+    status.timeoutInterval = calculateTimeout(status.avgRTT, status.rttVar);
+    status.rtoBackoff = 0;
 }
 int ReliableMsgManager::calculateTimeout(int avgRTT, int rttVar) {
-    // 超时时间 = 平均RTT + 4 * RTT方差
+    // 超时时间 = SRTT + max(时钟精度, 4 * RTTVAR)
     // 增加一个最小和最大值限制
-    int timeout = avgRTT + 4 * rttVar;
-    return max(100, min(timeout, 10000)); // 最小100ms，最大10s
+    int timeout = avgRTT + max(RETRANSMIT_TICK_MS, 4 * rttVar);
+    return max(MIN_RTO_MS, min(timeout, MAX_RTO_MS));
+}
+
+int ReliableMsgManager::currentTimeout(const ConnectionStatus& status) const {
+    long long timeout = static_cast<long long>(status.timeoutInterval) << status.rtoBackoff;
+    return static_cast<int>(min(timeout, static_cast<long long>(MAX_RTO_MS)));
 }
 // 处理接收到的数据消息（返回是否为新消息）
 //就是将新来的数据消息进行去重处理，已经处理过的消息就不再处理，返回false
-bool ReliableMsgManager::processDataMessage(const muduo::net::TcpConnectionPtr& conn, const MyProtoMsg& msg) {
+bool ReliableMsgManager::processDataMessage(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, const MyProtoMsg& msg) {
     if (!conn || !conn->connected()) {
         return false;
     }
     
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    std::string connName = conn->name();
     uint32_t sequence = msg.head.sequence;
     
     // 增加消息有效性检查
@@ -172,28 +542,25 @@ bool ReliableMsgManager::processDataMessage(const muduo::net::TcpConnectionPtr&
         return false;
     }
     
-    // 检查消息是否已处理过（去重）
-    auto& processed = processedSequences_[connName];
-    if (processed.count(sequence) > 0) {
-        // 消息已处理过，发送确认但不进行业务处理
-        
+    // 数据帧捎带的确认号对重复消息同样有效
+    processPiggybackAck(conn, state, msg.head.ack);
+    
+    // 检查消息是否已处理过（去重），新消息同时记录到去重窗口
+    if (!state.receivedWindow.accept(sequence)) {
+        // 消息已处理过，说明对端没有收到之前的确认，重新发送确认但不进行业务处理
+        sendCumulativeAck(conn, state);
         return false;
     }
     
-    // 记录消息已处理
-    processed.insert(sequence);
-    // 更新最后处理的序列号
-    auto& lastAcked=lastAckedSequence_[connName];
-    if(sequence>lastAcked){
-        lastAcked=sequence;
-    }
-    auto now=std::chrono::steady_clock::now();
-    auto& lastTime=lastAckTime_[connName];
-    auto timeSinceLastAck=std::chrono::duration_cast<std::chrono::milliseconds>(now - lastTime).count();
-    if(timeSinceLastAck>50||(sequence-lastAcked)>10){
-        // 超过50ms未发送确认，或者累计未确认消息超过10条，发送批量确认
-        sendBatchAck(conn,lastAcked);
-        lastTime=now;
+    uint32_t unacked = state.receivedWindow.deliveredUpTo() - state.lastAckedSequence;
+    if(state.receivedWindow.hasGaps()||unacked>=delayedAckMessages_){
+        // 乱序到达时立即发送SACK，发送端据此只重传空洞；累计的未确认消息够多时立即发送批量确认
+        sendCumulativeAck(conn, state);
+    } else if (!state.ackTimer.scheduled()) {
+        // 否则延迟确认：定时器到期前本端发出的数据帧会捎带确认号，到期时仍未确认才单独发送
+        uint64_t now = nowTick();
+        ackWheel_.add(&state.ackTimer, now + static_cast<uint64_t>(delayedAckMs_) / RETRANSMIT_TICK_MS, now);
+        armTimer();
     }
     
     // 消息为新消息，需要进行业务处理
@@ -208,154 +575,358 @@ void ReliableMsgManager::sendAck(const muduo::net::TcpConnectionPtr& conn, uint3
     
     // 创建确认消息
     MyProtoMsg ackMsg;
-    ackMsg.head.type = 1; // 设置为确认消息类型
+    ackMsg.head.type = MY_PROTO_TYPE_ACK; // 设置为确认消息类型
     ackMsg.head.sequence = sequence;
     ackMsg.head.version = 1; // 设置版本号为1
+    ackMsg.head.server = 0;
     
-    // 编码并发送确认消息
-    MyProtoEncode encoder;
-    uint32_t len = 0;
-    uint8_t* data = encoder.encode(&ackMsg, len);
-    
-    if (data && len > 0) {
-        conn->send(data, len);
-        delete[] data;
-    }
+    // 确认消息只有协议头，直接编码到栈上发送
+    uint8_t frame[MY_PROTO_HEAD_SIZE];
+    encoder_.encodeControl(&ackMsg, frame);
+    conn->send(frame, sizeof(frame));
 }
 
-// 实现从连接名称获取连接指针的方法
-muduo::net::TcpConnectionPtr ReliableMsgManager::getConnectionByName(const std::string& connName) {
-    auto it = connectionMap_.find(connName);
-    if (it != connectionMap_.end()) {
-        // 尝试将弱引用升级为强引用
-        muduo::net::TcpConnectionPtr conn = it->second.lock();
-        if (conn && conn->connected()) {
-            return conn;
-        }
-        // 连接已失效，清理映射
-        connectionMap_.erase(it);
-    }
-    return nullptr;
-}
 void ReliableMsgManager::sendBatchAck(const muduo::net::TcpConnectionPtr& conn, uint32_t maxSequence)
 {
     if(!conn||!conn->connected()){
         return;
     }
     MyProtoMsg ackmsg;
-    ackmsg.head.type=2; //确认消息类型
+    ackmsg.head.type=MY_PROTO_TYPE_BATCH_ACK; //确认消息类型
     ackmsg.head.sequence=maxSequence;// 最大已确认序列号
     ackmsg.head.version=1; // 设置版本号为1
-    MyProtoEncode encoder;
-    uint32_t len=0;
-    uint8_t* data=encoder.encode(&ackmsg,len);
-    if (data && len > 0) {
-        conn->send(data, len);
-        delete[] data;
+    ackmsg.head.server=0;
+    uint8_t frame[MY_PROTO_HEAD_SIZE];
+    encoder_.encodeControl(&ackmsg, frame);
+    conn->send(frame, sizeof(frame));
+}
+
+// 累计确认号取去重窗口的水位（不晚于它的都已收到），而不是收到的最大序列号，避免把空洞也确认掉
+void ReliableMsgManager::sendCumulativeAck(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state) {
+    if (!conn || !conn->connected() || !state.receivedWindow.initialized()) {
+        return;
     }
+    uint32_t cumulative = state.receivedWindow.deliveredUpTo();
+    state.lastAckedSequence = cumulative;
+    state.lastAckTime = std::chrono::steady_clock::now();
+    state.ackTimer.cancel();
+    if (!state.receivedWindow.hasGaps()) {
+        sendBatchAck(conn, cumulative);
+        return;
+    }
+    
+    SeqRange ranges[SACK_MAX_RANGES];
+    size_t count = state.receivedWindow.receivedRanges(ranges, SACK_MAX_RANGES);
+    uint8_t frame[MY_PROTO_HEAD_SIZE + 1 + SACK_MAX_RANGES * SACK_RANGE_SIZE];
+    uint8_t* payload = frame + MY_PROTO_HEAD_SIZE;
+    payload[0] = static_cast<uint8_t>(count);
+    for (size_t i = 0; i < count; i++) {
+        uint16_t offset = htons(static_cast<uint16_t>(ranges[i].begin - cumulative - 1));
+        uint16_t length = htons(static_cast<uint16_t>(ranges[i].end - ranges[i].begin));
+        memcpy(payload + 1 + i * SACK_RANGE_SIZE, &offset, sizeof(offset));
+        memcpy(payload + 1 + i * SACK_RANGE_SIZE + 2, &length, sizeof(length));
+    }
+    
+    MyProtoMsg sackMsg;
+    sackMsg.head.type = MY_PROTO_TYPE_SACK;
+    sackMsg.head.sequence = cumulative;
+    sackMsg.head.version = 1;
+    sackMsg.head.server = 0;
+    uint32_t payloadLen = static_cast<uint32_t>(1 + count * SACK_RANGE_SIZE);
+    encoder_.encodeControl(&sackMsg, frame, payloadLen);
+    conn->send(frame, static_cast<int>(MY_PROTO_HEAD_SIZE + payloadLen));
+}
+
+void ReliableMsgManager::beginBatch(const muduo::net::TcpConnectionPtr& conn) {
+    endBatch();
+    batchConn_ = conn;
+}
+
+void ReliableMsgManager::endBatch() {
+    if (batchConn_ && batchBuffer_.readableBytes() > 0 && batchConn_->connected()) {
+        batchConn_->send(&batchBuffer_);
+    }
+    batchBuffer_.retrieveAll();
+    batchConn_.reset();
+}
+
+// 保存的帧不可修改，拷贝到复用的发送缓冲区后改写帧尾的确认号（CRC增量更新），只在所属IO线程调用
+// 批量发送期间拷贝到批量缓冲区的末尾，由endBatch统一发送
+void ReliableMsgManager::sendDataFrame(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, const MyProtoFramePtr& frame) {
+    uint8_t flags = static_cast<uint8_t>((*frame)[TYPE_OFFSET]) & ~MY_PROTO_TYPE_MASK;
+    bool piggyback = (flags & MY_PROTO_FLAG_PIGGYBACK_ACK) && state.receivedWindow.initialized();
+    bool batching = batchConn_ == conn;
+    if (!piggyback && !batching) {
+        conn->send(frame->data(), static_cast<int>(frame->size()));
+        return;
+    }
+    muduo::net::Buffer& out = batching ? batchBuffer_ : sendBuffer_;
+    if (!batching) {
+        out.retrieveAll();
+    }
+    size_t offset = out.readableBytes();
+    out.append(frame->data(), frame->size());
+    if (!piggyback) {
+        return; // 只可能是批量发送
+    }
+    uint32_t cumulative = state.receivedWindow.deliveredUpTo();
+    patchPiggybackAck(reinterpret_cast<uint8_t*>(const_cast<char*>(out.peek())) + offset,
+                      static_cast<uint32_t>(frame->size()), cumulative);
+    if (!batching) {
+        conn->send(&out);
+    }
+    // 没有空洞时捎带的确认号已经确认了收到的全部消息，不必再单独发确认帧
+    state.lastAckedSequence = cumulative;
+    state.lastAckTime = std::chrono::steady_clock::now();
+    if (!state.receivedWindow.hasGaps()) {
+        state.ackTimer.cancel();
+    }
+}
+
+void ReliableMsgManager::onDelayedAckTimeout(TimerNode* node) {
+    ReliableConnState& state = *static_cast<DelayedAckTimer*>(node)->state;
+    muduo::net::TcpConnectionPtr conn = state.conn.lock();
+    if (conn) {
+        sendCumulativeAck(conn, state);
+    }
+}
+
+uint64_t ReliableMsgManager::nowTick() const {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - epoch_).count();
+    return static_cast<uint64_t>(elapsed) / RETRANSMIT_TICK_MS;
+}
+
+void ReliableMsgManager::scheduleRetransmit(ReliableConnState& state, PendingMessage& pending) {
+    uint64_t now = nowTick();
+    uint64_t expire = now + static_cast<uint64_t>(currentTimeout(state.status)) / RETRANSMIT_TICK_MS;
+    if (pending.deadline != 0 && pending.deadline < expire) {
+        expire = pending.deadline;
+    }
+    retransmitWheel_.add(&pending, expire, now);
+    armTimer();
+}
+
+// 只在时间轮里有定时器时才设置loop定时器，到期时间取时间轮中最近可能到期的tick
+void ReliableMsgManager::armTimer() {
+    if (!loop_) {
+        return;
+    }
+    uint64_t tick = 0;
+    uint64_t ackTick = 0;
+    bool hasRetransmit = retransmitWheel_.nextExpiryHint(tick);
+    bool hasAck = ackWheel_.nextExpiryHint(ackTick);
+    if (!hasRetransmit && !hasAck) {
+        return;
+    }
+    if (!hasRetransmit || (hasAck && ackTick < tick)) {
+        tick = ackTick;
+    }
+    if (armedTick_ != 0 && armedTick_ <= tick) {
+        return; // 已有更早的定时器
+    }
+    armedTick_ = tick;
+    uint64_t now = nowTick();
+    double delaySec = tick > now ? static_cast<double>((tick - now) * RETRANSMIT_TICK_MS) / 1000.0 : 0.0;
+    std::weak_ptr<bool> alive = alive_;
+    loop_->runAfter(delaySec, [this, alive, tick]() {
+        if (!alive.lock()) {
+            return; // 管理器已销毁
+        }
+        if (armedTick_ == tick) {
+            armedTick_ = 0;
+        }
+        checkTimeoutMessages();
+    });
 }
 
 /**
- * 检查并处理超时消息的核心方法
- * 该方法会遍历所有待确认的消息，检查是否超时，如果超时则进行重传或标记失败
+ * 推进重传时间轮
+ * 只处理到期的消息，开销与到期数量成正比，与待确认消息总数无关
  */
 void ReliableMsgManager::checkTimeoutMessages() {
-    // 加锁保证线程安全，防止并发访问导致的数据竞争
-    std::lock_guard<std::mutex> lock(mutex_);
-    // 获取当前时间，用于计算消息是否超时
-    auto now = std::chrono::steady_clock::now();
+    uint64_t now = nowTick();
+    ackWheel_.advance(now, std::bind(&ReliableMsgManager::onDelayedAckTimeout, this, std::placeholders::_1));
+    retransmitWheel_.advance(now, std::bind(&ReliableMsgManager::onRetransmitTimeout, this, std::placeholders::_1));
+    armTimer();
+    notifyDelivery();
+}
+
+// 单条消息超时：未超过最大重试次数和投递期限时重传并重新计时，否则放弃
+void ReliableMsgManager::onRetransmitTimeout(TimerNode* node) {
+    PendingMessage& pendingMsg = *static_cast<PendingMessage*>(node);
+    ReliableConnState& state = *pendingMsg.state;
+    uint32_t sequence = pendingMsg.sequence;
+    // 将弱引用升级为强引用
+    muduo::net::TcpConnectionPtr conn = state.conn.lock();
     
-    // 遍历所有连接的待确认消息列表
-    for (auto& connPair : pendingMessages_) {
-        // 获取连接名称和该连接对应的消息映射表
-        std::string connName = connPair.first;
-        auto& msgMap = connPair.second;
-        
-        int timeoutInterval = RETRY_INTERVAL_MS; // 默认超时时间1秒
-        auto statusIt=connectionStatusMap_.find(connName);
-        if(statusIt!=connectionStatusMap_.end()){
-            timeoutInterval=statusIt->second.timeoutInterval;
-        }
-        // 遍历该连接下的所有待确认消息（使用迭代器以便在遍历时删除元素）
-        for (auto it = msgMap.begin(); it != msgMap.end();) {
-            // 获取当前消息和其发送时间
-            auto& pendingMsg = it->second;
-            // 计算消息已发送的时间（毫秒）
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(now - pendingMsg.sendTime).count();
-            
-            // 检查消息是否超时
-            if (duration > timeoutInterval) {
-                // 检查是否超过最大重试次数
-                if (pendingMsg.retryCount < MAX_RETRY_COUNT) {
-                    // 增加重试计数并更新发送时间
-                    pendingMsg.retryCount++;
-                    pendingMsg.sendTime = now;
-                    
-                    try {
-                        // 通过连接名称获取连接指针
-                        muduo::net::TcpConnectionPtr conn = getConnectionByName(connName);
-                        
-                        // 检查连接是否有效且已连接
-                        if (conn && conn->connected()) {
-                            // 确保重发消息时版本号正确设置为1
-                            pendingMsg.msg.head.version = 1;
-                            // 创建编码器并编码消息
-                            MyProtoEncode encoder;
-                            uint32_t len = 0;
-                            uint8_t* data = encoder.encode(const_cast<MyProtoMsg*>(&pendingMsg.msg), len);
-                            
-                            if (data && len > 0) {
-                                // 发送重编码后的消息
-                                conn->send(data, len);
-                                // 输出调试信息
-                                std::cout << "Retrying message, sequence: " << it->first << ", retry count: " << pendingMsg.retryCount << std::endl;
-                                // 释放编码后的缓冲区内存
-                                delete[] data;
-                                // 移动到下一个消息
-                                ++it;
-                            } else {
-                                // 编码失败，从待确认列表中删除该消息
-                                std::cout << "Failed to encode message during retry, sequence: " << it->first << std::endl;
-                                it = msgMap.erase(it);
-                            }
-                        } else {
-                            // 连接无效或已断开，从待确认列表中删除该消息
-                            std::cout << "Connection invalid during retry, sequence: " << it->first << std::endl;
-                            it = msgMap.erase(it);
-                        }
-                    } catch (const std::exception& e) {
-                        // 捕获并处理重传过程中的异常
-                        std::cerr << "Error during message retry: " << e.what() << std::endl;
-                        // 异常情况下也从待确认列表中删除该消息
-                        it = msgMap.erase(it);
-                    }
-                } else {
-                    // 超过最大重试次数，标记消息发送失败
-                    std::cout << "Message failed after max retries, sequence: " << it->first << std::endl;
-                    // 从待确认列表中删除该消息
-                    it = msgMap.erase(it);
-                }
-            } else {
-                // 消息未超时，继续检查下一个消息
-                ++it;
-            }
-        }
-        
-        // 如果该连接下没有待确认消息了，清理对应的连接条目
-        if (msgMap.empty()) {
-            pendingMessages_.erase(connPair.first);
+    // 检查是否超过投递期限或最大重试次数
+    bool expired = pendingMsg.deadline != 0 && nowTick() >= pendingMsg.deadline;
+    if (expired || pendingMsg.retryCount >= pendingMsg.maxRetries) {
+        std::cout << (expired ? "Message expired before acknowledgement, sequence: " : "Message failed after max retries, sequence: ")
+                  << sequence << std::endl;
+        abandonPending(conn, state, sequence, expired ? DELIVERY_EXPIRED : DELIVERY_MAX_RETRIES);
+        return;
+    }
+    
+    try {
+        // 检查连接是否有效且已连接
+        if (conn && conn->connected()) {
+            // 超时说明网络可能拥塞，窗口降到下限重新慢启动；超时时间按这条消息的重传次数指数退避，
+            // 同一轮集中超时的多条消息只放大一次，不会把超时时间叠加放大
+            onLoss(state, sequence, true);
+            state.status.rtoBackoff = max(state.status.rtoBackoff, min(pendingMsg.retryCount + 1, MAX_RTO_BACKOFF));
+            retransmit(conn, state, pendingMsg);
+            std::cout << "Retrying message, sequence: " << sequence << ", retry count: " << pendingMsg.retryCount << std::endl;
+        } else {
+            // 连接无效或已断开，从待确认列表中删除该消息
+            std::cout << "Connection invalid during retry, sequence: " << sequence << std::endl;
+            abandonPending(conn, state, sequence, DELIVERY_CONNECTION_CLOSED);
         }
+    } catch (const std::exception& e) {
+        // 捕获并处理重传过程中的异常，异常情况下也从待确认列表中删除该消息
+        std::cerr << "Error during message retry: " << e.what() << std::endl;
+        abandonPending(conn, state, sequence, DELIVERY_MAX_RETRIES);
     }
 }
 
+// 重传直接发送首次编码的帧，不再重新序列化
+void ReliableMsgManager::retransmit(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, PendingMessage& pending) {
+    // 增加重试计数，发送时间保留首次发送的时间（重传后的确认不再用于RTT采样）
+    pending.retryCount++;
+    pending.retransmitted = true;
+    sendDataFrame(conn, state, pending.frame);
+    scheduleRetransmit(state, pending);
+}
+
 // 修改cleanupConnection方法，确保清理所有相关资源
-void ReliableMsgManager::cleanupConnection(const std::string& connName) {
-    std::lock_guard<std::mutex> lock(mutex_);
+void ReliableMsgManager::cleanupConnection(ReliableConnState& state) {
+    // 清理该连接的所有待处理消息、排队的帧和已处理序列号，还没有确认的消息通知投递失败；
+    // 保留的会话期满时投递期限可能早已过去（断开期间不计时），这些按超时通知
+    uint64_t now = nowTick();
+    state.pendingMessages.forEach([this, now](uint32_t sequence, PendingMessage& pending) {
+        bool expired = pending.deadline != 0 && now >= pending.deadline;
+        recordFailed(pending.callbacks, sequence, expired ? DELIVERY_EXPIRED : DELIVERY_CONNECTION_CLOSED);
+    });
+    for (const QueuedFrame& queued : state.sendQueue) {
+        recordFailed(queued.callbacks, queued.sequence, DELIVERY_CONNECTION_CLOSED);
+    }
+    state.pendingMessages.clear();
+    state.sendQueue.clear();
+    state.status.inflightMessages = 0;
+    state.status.inflightBytes = 0;
+    state.receivedWindow.reset();
+    state.ackTimer.cancel();
+    
+    // 从连接表中移除，编号留给后续连接复用
+    if (connection(state.id) == &state) {
+        connections_[state.id].reset();
+        freeIds_.push_back(state.id);
+    }
+    notifyDelivery();
+}
+void ReliableMsgManager::detachConnection(ReliableConnState& state) {
+    state.pendingMessages.forEach([](uint32_t, PendingMessage& pending) {
+        pending.cancel();
+    });
+    state.ackTimer.cancel();
+    state.conn.reset();
+    if (connection(state.id) == &state) {
+        connections_[state.id].reset();
+        freeIds_.push_back(state.id);
+    }
+}
+
+void ReliableMsgManager::resumeConnection(const muduo::net::TcpConnectionPtr& conn, const ReliableConnStatePtr& state,
+                                          uint32_t peerAck) {
+    state->conn = conn;
+    registerConnection(state);
+    
+    // 新连接的拥塞状况未知，窗口从初始值重新开始；RTT估算沿用旧连接的
+    ConnectionStatus& status = state->status;
+    status.congestionWindow = INITIAL_CONGESTION_WINDOW;
+    status.ackedInWindow = 0;
+    status.inRecovery = false;
+    status.rtoBackoff = 0;
+    if (peerAck != 0) {
+        releaseCumulative(*state, peerAck);
+    }
+    
+    // 断开期间没有重传定时器，投递期限在这里补查：已经过期的消息不再重放，通知投递超时
+    uint64_t now = nowTick();
+    std::vector<uint32_t> expired;
+    state->pendingMessages.forEach([now, &expired](uint32_t sequence, PendingMessage& pending) {
+        if (pending.deadline != 0 && now >= pending.deadline) {
+            expired.push_back(sequence);
+        }
+    });
+    for (uint32_t sequence : expired) {
+        abandonPending(muduo::net::TcpConnectionPtr(), *state, sequence, DELIVERY_EXPIRED);
+    }
     
-    // 清理该连接的所有待处理消息和已处理序列号
-    pendingMessages_.erase(connName);
-    processedSequences_.erase(connName);
+    // 旧连接上发出的帧可能已经丢失，全部重放并重新计时；重放不占用重传次数（断线不是消息本身的问题），
+    // 但确认同样分不清对应哪一次发送，不参与RTT采样
+    size_t replayed = state->pendingMessages.size();
+    beginBatch(conn);
+    state->pendingMessages.forEach([this, &conn, &state](uint32_t, PendingMessage& pending) {
+        pending.retransmitted = true;
+        sendDataFrame(conn, *state, pending.frame);
+        scheduleRetransmit(*state, pending);
+    });
+    endBatch();
+    std::cout << "[ReliableManager] Session " << state->sessionId << " resumed, replayed " << replayed << " messages" << std::endl;
+    flushSendQueue(conn, *state);
+    notifyDelivery();
+}
+
+void ReliableMsgManager::sendHello(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state) {
+    if (!conn || !conn->connected()) {
+        return;
+    }
+    uint32_t cumulative = state.receivedWindow.initialized() ? state.receivedWindow.deliveredUpTo() : 0;
+    uint8_t frame[MY_PROTO_HEAD_SIZE + SESSION_HELLO_SIZE];
+    uint8_t* payload = frame + MY_PROTO_HEAD_SIZE;
+    uint32_t high = htonl(static_cast<uint32_t>(state.sessionId >> 32));
+    uint32_t low = htonl(static_cast<uint32_t>(state.sessionId));
+    uint32_t ack = htonl(cumulative);
+    // 发送起点：最早还会（重新）发出的序列号的前一个，依次看待确认列表、发送队列和下一个序列号
+    uint32_t first = state.nextSequence;
+    if (!state.pendingMessages.empty()) {
+        first = state.pendingMessages.baseSequence();
+    } else if (!state.sendQueue.empty()) {
+        first = state.sendQueue.front().sequence;
+    }
+    uint32_t base = htonl(first - 1);
+    memcpy(payload, &high, sizeof(high));
+    memcpy(payload + 4, &low, sizeof(low));
+    memcpy(payload + 8, &ack, sizeof(ack));
+    memcpy(payload + 12, &base, sizeof(base));
     
-    // 清理连接映射
-    connectionMap_.erase(connName);
-}
\ No newline at end of file
+    MyProtoMsg helloMsg;
+    helloMsg.head.type = MY_PROTO_TYPE_HELLO;
+    helloMsg.head.sequence = 0;
+    helloMsg.head.version = 1;
+    helloMsg.head.server = 0;
+    encoder_.encodeControl(&helloMsg, frame, SESSION_HELLO_SIZE);
+    conn->send(frame, static_cast<int>(sizeof(frame)));
+    if (cumulative != 0) {
+        // HELLO带的确认号同样确认了收到的消息
+        state.lastAckedSequence = cumulative;
+        state.lastAckTime = std::chrono::steady_clock::now();
+    }
+}
+
+bool ReliableMsgManager::parseHello(const MyProtoMsg& msg, uint64_t& sessionId, uint32_t& ack, uint32_t& sendBase) {
+    const uint8_t* payload = reinterpret_cast<const uint8_t*>(msg.raw.data);
+    if (msg.head.type != MY_PROTO_TYPE_HELLO || !payload || msg.raw.len < SESSION_HELLO_SIZE) {
+        return false;
+    }
+    uint32_t high = 0, low = 0, cumulative = 0, base = 0;
+    memcpy(&high, payload, sizeof(high));
+    memcpy(&low, payload + 4, sizeof(low));
+    memcpy(&cumulative, payload + 8, sizeof(cumulative));
+    memcpy(&base, payload + 12, sizeof(base));
+    sessionId = (static_cast<uint64_t>(ntohl(high)) << 32) | ntohl(low);
+    ack = ntohl(cumulative);
+    sendBase = ntohl(base);
+    return true;
+}
@@ -1,82 +1,324 @@
 #ifndef __RELIABLE_MSG_MANAGER_H
 #define __RELIABLE_MSG_MANAGER_H
 
-#include <mutex>
+#include <atomic>
 #include <unordered_map>
+#include <vector>
 #include <queue>
+#include <deque>
+#include <functional>
 #include <chrono>
-#include <unordered_set>
 #include "myproto.h"
+#include "TimingWheel.h"
+#include "SequenceWindow.h"
+#include "PendingRing.h"
 #include "muduo/net/TcpConnection.h"
 
 // 消息重传配置
-const int MAX_RETRY_COUNT = 3; // 最大重传次数
-const int RETRY_INTERVAL_MS = 1000; // 重传间隔（毫秒）
+const int MAX_RETRY_COUNT = 3; // 默认最大重传次数
+const int RETRY_INTERVAL_MS = 1000; // 初始重传超时（毫秒），连接还没有RTT采样时使用
+const int MIN_RTO_MS = 100; // 重传超时下限
+const int MAX_RTO_MS = 10000; // 重传超时上限（包括退避之后）
+const int MAX_RTO_BACKOFF = 6; // 超时退避的最大次数，RTO最多放大2^6倍（仍受MAX_RTO_MS限制）
+const int RETRANSMIT_TICK_MS = 1; // 重传时间轮的tick精度（毫秒）
+const int SACK_MAX_RANGES = 16; // 一个SACK帧最多携带的区间数
+const int FAST_RETRANSMIT_THRESHOLD = 3; // 消息被多少个SACK越过后快速重传（不等超时）
+
+// 发送窗口（拥塞控制）配置
+const int INITIAL_CONGESTION_WINDOW = 10; // 初始窗口（消息数）
+const int MIN_CONGESTION_WINDOW = 2; // 窗口下限
+const int INITIAL_SLOW_START_THRESHOLD = 256; // 初始慢启动阈值
+// 窗口上限，同时限制最早未确认消息到最新发送消息的序列号跨度：
+// 跨度超过接收端去重窗口时，滑出窗口的空洞会被对端当作已收到而确认掉
+const int MAX_CONGESTION_WINDOW = DedupWindow::WINDOW_BITS / 2;
+const size_t MAX_INFLIGHT_BYTES = 4 * 1024 * 1024; // 飞行中字节数上限
+const size_t SEND_QUEUE_LIMIT = 8192; // 每个连接排队等待发送的消息上限，超过时拒绝发送
+const size_t SEND_QUEUE_HIGH_WATER = 1024; // 排队消息数达到该值时通知发送方背压
+const size_t SEND_QUEUE_LOW_WATER = 256; // 背压后排队消息数降到该值时通知解除
+// 延迟确认：收到按序消息后最多等待DELAYED_ACK_MS毫秒或DELAYED_ACK_MESSAGES条消息再发确认，
+// 期间本端发出的数据帧会捎带确认号，请求/响应式的流量基本不需要单独的确认帧
+const int DELAYED_ACK_MS = 20;
+const uint32_t DELAYED_ACK_MESSAGES = 2;
+
+// SACK帧负载（网络字节序）：1字节区间数n，随后n个区间，每个区间为2字节起始偏移+2字节长度
+// 偏移相对于累计确认号+1，接收端去重窗口只有DedupWindow::WINDOW_BITS位，16位足够
+const uint32_t SACK_RANGE_SIZE = 4;
+
+// 会话恢复：连接断开后保留会话（序列号空间、待确认消息、发送队列和去重窗口），
+// 对端在保留期内带着会话ID重连时接着使用，未确认的消息在新连接上重放，重复的由保留的去重窗口丢弃
+const int SESSION_RETAIN_MS = 60000; // 断开后会话保留的时间（毫秒）
+// HELLO帧负载（网络字节序）：8字节会话ID（0表示新会话）+ 4字节本端的累计确认号（0表示还没有收到过消息）
+// + 4字节本端的发送起点（之后发出的数据帧序列号都晚于它），对端开始新会话时从这里建立去重窗口
+const uint32_t SESSION_HELLO_SIZE = 16;
+
+struct ReliableConnState;
+
+typedef enum DeliveryFailure //消息放弃投递的原因
+{
+	DELIVERY_MAX_RETRIES = 0, //重传次数用完仍未确认
+	DELIVERY_EXPIRED = 1, //超过投递期限仍未确认
+	DELIVERY_CONNECTION_CLOSED = 2, //连接关闭时仍未确认（包括还在发送队列中没有发出的消息）
+	DELIVERY_QUEUE_FULL = 3, //发送队列已满，消息没有发出
+}DeliveryFailure;
+
+// 投递结果回调，在连接所属的IO线程中执行，每条消息最多调用其中一个一次
+// latencyUs为首次发送到收到确认的时间（微秒）
+typedef std::function<void(uint32_t sequence, int64_t latencyUs)> DeliveryAckedCallback;
+typedef std::function<void(uint32_t sequence, DeliveryFailure reason)> DeliveryFailedCallback;
+struct DeliveryCallbacks {
+    DeliveryAckedCallback onAcked;
+    DeliveryFailedCallback onFailed;
+};
+typedef std::shared_ptr<DeliveryCallbacks> DeliveryCallbacksPtr;
+
+// 重传策略，可以按服务号分别配置
+struct RetryPolicy {
+    int maxRetries = MAX_RETRY_COUNT; // 最大重传次数，用完后放弃
+    int deadlineMs = 0; // 投递期限（毫秒，从首次发送算起），到期仍未确认则放弃；0表示不限
+};
+
+// 连接的延迟确认定时器，挂在管理器的确认时间轮上
+struct DelayedAckTimer : public TimerNode {
+    ReliableConnState* state = nullptr;
+};
 
 // 等待确认的消息信息就是已经发送但没确认消息的数据
-struct PendingMessage {
-    MyProtoMsg msg; // 消息内容
-    std::chrono::steady_clock::time_point sendTime; // 发送时间
-    int retryCount; // 已重传次数
+// 本身就是重传时间轮上的定时器节点，到期时间为发送时间+超时时间；从pendingMessages中删除即取消定时器
+// 存放在按序列号下标访问的PendingRing中，环扩容时会被搬移，不要长期保存它的指针
+// 只保存首次发送时编码好的帧（与首次发送共享同一份字节），重传直接原样发送，内存占用约等于线路上的帧大小
+struct PendingMessage : public TimerNode {
+    uint32_t sequence = 0; // 消息序列号
+    MyProtoFramePtr frame; // 编码好的完整帧
+    std::chrono::steady_clock::time_point sendTime; // 首次发送时间，重传不更新
+    int retryCount = 0; // 已重传次数（超时和快速重传），用完重传策略的次数后放弃
+    bool retransmitted = false; // 发送过不止一次（重传或会话恢复时重放），确认不参与RTT采样（Karn算法）
+    int maxRetries = MAX_RETRY_COUNT; // 按服务号的重传策略确定的最大重传次数
+    uint64_t deadline = 0; // 投递期限（时间轮tick），0表示不限
+    uint8_t sackMisses = 0; // 被SACK越过（之后的消息已收到而它没有）的次数
+    bool fastRetransmitted = false; // 已经快速重传过，之后只按超时重传
+    ReliableConnState* state = nullptr; // 所属连接，定时器到期时用来找回连接
+    DeliveryCallbacksPtr callbacks; // 投递结果回调，没有时为空
+};
+
+// 连接的网络统计信息，重传超时按RFC 6298计算
+struct ConnectionStatus {
+    int avgRTT = 0; // 平滑往返时间（SRTT）
+    int lastRTT = 0; // 上次往返时间
+    int rttVar = 0; // RTT平均偏差（RTTVAR）
+    int timeoutInterval = RETRY_INTERVAL_MS; // 按RTT估算的超时时间（未退避）
+    int rtoBackoff = 0; // 超时退避次数，实际超时为timeoutInterval << rtoBackoff；收到有效RTT采样后清零
+    int inflightMessages = 0; // 飞行中消息数量
+    size_t inflightBytes = 0; // 飞行中消息的字节数
+    int congestionWindow = INITIAL_CONGESTION_WINDOW; // 拥塞窗口（消息数）
+    int slowStartThreshold = INITIAL_SLOW_START_THRESHOLD; // 慢启动阈值
+    int ackedInWindow = 0; // 拥塞避免阶段本轮已确认的消息数，满一个窗口时窗口加1
+    uint32_t recoverySequence = 0; // 检测到丢包时已发送的最大序列号，确认越过它之前同一轮的丢包不再减小窗口
+    bool inRecovery = false; // 是否处于丢包恢复阶段
+    bool recoveryByTimeout = false; // 恢复阶段由超时触发（重新慢启动），否则为快速恢复（窗口保持不变）
+};
+
+// 发送窗口已满时排队等待发送的帧
+struct QueuedFrame {
+    uint32_t sequence;
+    MyProtoFramePtr frame;
+    DeliveryCallbacksPtr callbacks;
 };
 
+// 待通知的投递结果，确认或放弃消息时先记下来，处理完当前事件后统一回调
+// 回调中可能再发送消息，不能在遍历待确认列表的过程中直接执行
+struct DeliveryEvent {
+    DeliveryCallbacksPtr callbacks;
+    uint32_t sequence;
+    bool acked;
+    int64_t latencyUs;
+    DeliveryFailure reason;
+};
+
+// 单个连接的可靠性状态，由连接上下文持有，不再按连接名称分散保存在多个map中
+// 每个连接有独立的序列号空间，序列号在连接内连续，接收端的去重窗口不会因为其他连接的消息出现空洞
+// 建立了会话的连接断开后状态整体保留，重连时挂到新连接上（可能属于另一个IO线程的管理器）
+struct ReliableConnState {
+    uint32_t id = 0; // 在所属管理器中的编号（连接表下标），连接关闭后回收复用
+    uint64_t sessionId = 0; // 会话ID，0表示没有经过HELLO握手（不能恢复）
+    uint32_t nextSequence = 1; // 本连接下一个要使用的序列号
+    uint32_t lastAckedSequence = 0; // 上次发出（单独发送或捎带）的累计确认号
+    std::chrono::steady_clock::time_point lastAckTime; // 上次发出确认的时间
+    DelayedAckTimer ackTimer; // 延迟确认定时器，确认发出（包括捎带）时取消
+    ConnectionStatus status; // 网络统计信息
+    std::weak_ptr<muduo::net::TcpConnection> conn; // 连接弱指针，避免循环引用
+    PendingRing<PendingMessage> pendingMessages; // 待确认的消息，按序列号组织的环形缓冲区
+    std::deque<QueuedFrame> sendQueue; // 发送窗口已满时排队的帧，窗口打开后按顺序发出
+    bool backpressured = false; // 是否已通知发送方背压
+    DedupWindow receivedWindow; // 已处理的消息序列号（累计水位+乱序位图），用于去重，内存固定
+
+    // 分配序列号，只在IO线程中确定消息能发出时调用：分配出去的序列号一定会发出，接收端不会出现补不上的空洞，
+    // 序列号也按发出的顺序递增
+    uint32_t allocateSequence() {
+        uint32_t sequence = nextSequence++;
+        if (sequence == 0) {
+            // 回绕后跳过0，0表示发送失败；接收端的去重窗口把0当作已收到
+            sequence = nextSequence++;
+        }
+        return sequence;
+    }
+};
+typedef std::shared_ptr<ReliableConnState> ReliableConnStatePtr;
+
 // 可靠消息管理器
+// 每个IO线程（EventLoop）一个实例，只管理该线程上的连接；除静态方法外都只在所属线程调用，
+// 连接状态（包括序列号分配）不跨线程共享，因此热路径上不需要加锁
 class ReliableMsgManager {
 public:
-    ReliableMsgManager();
+    // 背压回调：排队消息过多时以true调用，排队消息降下来后以false调用，在IO线程中执行
+    typedef std::function<void(const muduo::net::TcpConnectionPtr&, bool)> BackpressureCallback;
+    
+    // loop为管理器所属的IO线程，重传定时由该loop驱动；为空时只能靠外部调用checkTimeoutMessages推进
+    explicit ReliableMsgManager(muduo::net::EventLoop* loop = nullptr);
     ~ReliableMsgManager();
     
-    // 发送可靠消息
-    uint32_t sendReliableMessage(const muduo::net::TcpConnectionPtr& conn, const MyProtoMsg& msg);
+    // 为新连接创建可靠性状态，分配连接编号并登记到连接表
+    ReliableConnStatePtr addConnection(const muduo::net::TcpConnectionPtr& conn);
+    // 按连接编号查找可靠性状态，编号无效时返回nullptr
+    ReliableConnState* connection(uint32_t id) const;
+    
+    // 发送可靠消息：分配序列号并编码，发送窗口已满时进入连接的发送队列，返回序列号
+    // 连接已断开、发送队列已满或编码失败时返回0，此时不分配序列号，也不回调
+    // callbacks非空时在消息被确认或放弃时回调
+    uint32_t sendReliableMessage(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, const MyProtoMsg& msg,
+                                 const DeliveryCallbacksPtr& callbacks = DeliveryCallbacksPtr());
+    // 批量发送：beginBatch和endBatch之间发往conn的数据帧先写到批量缓冲区，endBatch时一次交给连接发送
+    // 一批消息只产生一次写调用；批量期间不要发送到其他连接（其他连接的帧照常立即发送）
+    void beginBatch(const muduo::net::TcpConnectionPtr& conn);
+    void endBatch();
+    // 按序列号把消息编码成可靠数据帧
+    static MyProtoFramePtr encodeDataFrame(const MyProtoMsg& msg, uint32_t sequence);
+    
+    // 发送接口返回提交编号时的准备工作（ConnectionHandler::sendMessage、MyProtoClient::sendMessage），任意线程可调用：
+    // - 其他线程发送时序列号要到IO线程发出时才分配，调用方先拿到提交编号（allocateTicket，非0，进程内递增）
+    // - prepareBody在调用线程把消息体序列化成原始字节挂到out.raw上，IO线程编码时只拷贝字节，失败返回false
+    // - ticketCallbacks包装投递结果回调，回调时用提交编号代替序列号，调用方据此对应到自己的消息
+    static uint32_t allocateTicket();
+    static bool prepareBody(const MyProtoMsg& msg, MyProtoMsg& out);
+    static DeliveryCallbacksPtr ticketCallbacks(uint32_t ticket, const DeliveryAckedCallback& onAcked,
+                                                const DeliveryFailedCallback& onFailed);
     
     // 处理接收到的确认消息
-    void processAckMessage(const muduo::net::TcpConnectionPtr& conn, const MyProtoMsg& msg);
+    void processAckMessage(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, const MyProtoMsg& msg);
     
-    // 处理接收到的数据消息（返回是否为新消息）
-    bool processDataMessage(const muduo::net::TcpConnectionPtr& conn, const MyProtoMsg& msg);
+    // 处理接收到的数据消息（返回是否为新消息），数据帧捎带的确认号也在这里处理
+    bool processDataMessage(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, const MyProtoMsg& msg);
+    // 处理对端捎带的累计确认号
+    void processPiggybackAck(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, uint32_t ack);
     
-    // 检查并处理超时消息
+    // 推进重传时间轮，重传到期的消息（正常情况下由所属loop上的定时器自动调用）
     void checkTimeoutMessages();
     // 清理连接相关资源
-    void cleanupConnection(const std::string& connName);
+    void cleanupConnection(ReliableConnState& state);
+    
+    // 连接断开但保留会话：取消定时器并移出连接表，待确认消息、发送队列、去重窗口和序列号原样保留
+    // 之后可以在任意管理器上resumeConnection，保留期满仍未恢复时调用cleanupConnection通知投递失败
+    // 断开期间不检查投递期限（会话可能在另一个IO线程恢复，定时器不能留在本管理器的时间轮上），恢复或清理时补查
+    void detachConnection(ReliableConnState& state);
+    // 把保留的会话挂到新连接上：先释放对端确认号peerAck之前的消息，投递期限已过的通知超时，其余未确认的消息在新连接上按序重放
+    // 调用前应该已经发出本端的HELLO，保证对端先恢复会话再收到重放的帧
+    void resumeConnection(const muduo::net::TcpConnectionPtr& conn, const ReliableConnStatePtr& state, uint32_t peerAck);
+    // 发送HELLO帧：携带会话ID、本端的累计确认号和发送起点
+    void sendHello(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state);
+    // 解析HELLO帧负载，格式不对时返回false
+    static bool parseHello(const MyProtoMsg& msg, uint64_t& sessionId, uint32_t& ack, uint32_t& sendBase);
+    
+    // 设置背压回调
+    void setBackpressureCallback(const BackpressureCallback& cb) { backpressureCallback_ = cb; }
+    // 设置延迟确认：最多延迟delayMs毫秒，或者累计maxMessages条按序消息后立即确认
+    void setDelayedAck(int delayMs, uint32_t maxMessages);
+    // 设置服务号server的重传策略，未单独设置的服务使用默认策略；只影响之后发送的消息
+    void setRetryPolicy(uint16_t server, const RetryPolicy& policy);
+    void setDefaultRetryPolicy(const RetryPolicy& policy) { defaultRetryPolicy_ = policy; }
     // 添加批量确认方法
     void sendBatchAck(const muduo::net::TcpConnectionPtr& conn, uint32_t maxSequence);
+    // 发送连接当前的接收状态：没有空洞时发批量确认，有空洞时发带已收区间的SACK
+    void sendCumulativeAck(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state);
 private:
-
-    // 保存每个连接的最后确认序列号
-    std::unordered_map<std::string, uint32_t> lastAckedSequence_;
-    // 批量确认定时器
-    std::unordered_map<std::string, std::chrono::steady_clock::time_point> lastAckTime_;
-    struct ConnectionStatus{
-        int avgRTT; // 平均往返时间
-        int lastRTT; // 上次往返时间
-        int rttVar; // RTT方差
-        int timeoutInterval; // 当前超时时间
-        int inflightMessages; // 飞行中消息数量
-    };
-    // 按连接保存网络统计信息
-    unordered_map<string, ConnectionStatus> connectionStatusMap_;
     // 计算重传超时时间
     int calculateTimeout(int rtt, int variance);
-    std::mutex mutex_; // 保护共享数据
-    uint32_t nextSequence_; // 下一个要使用的序列号
-    
-    // 按连接保存待确认的消息
-    std::unordered_map<std::string, std::unordered_map<uint32_t, PendingMessage>> pendingMessages_;
+    // 用一次RTT采样更新连接的统计信息
+    void updateRTT(ConnectionStatus& status, int rtt);
+    // 确认号sequence对应的消息没有重传过时，用它的首次发送时间采样RTT
+    void sampleRTT(ReliableConnState& state, uint32_t sequence);
+    // 当前生效的重传超时：估算值按退避次数放大
+    int currentTimeout(const ConnectionStatus& status) const;
+    // 帧所属服务号的重传策略
+    const RetryPolicy& retryPolicy(const MyProtoFramePtr& frame) const;
+    // 当前时间对应的时间轮tick
+    uint64_t nowTick() const;
+    // 把消息挂到时间轮上，到期时间为当前时间+连接当前的超时时间，不晚于消息的投递期限
+    void scheduleRetransmit(ReliableConnState& state, PendingMessage& pending);
+    // 时间轮上的消息到期：重传或放弃
+    void onRetransmitTimeout(TimerNode* node);
+    // 发送窗口是否还能发出序列号为sequence、大小为bytes的帧
+    bool windowAllows(const ReliableConnState& state, uint32_t sequence, size_t bytes) const;
+    // 发送刚编码好的数据帧：发送窗口已满或前面还有排队的帧时进入发送队列，否则立即发出
+    void sendReliableFrame(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, uint32_t sequence,
+                           const MyProtoFramePtr& frame, const DeliveryCallbacksPtr& callbacks);
+    // 把帧登记到待确认列表并发送
+    void transmit(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, uint32_t sequence,
+                  const MyProtoFramePtr& frame, const DeliveryCallbacksPtr& callbacks);
+    // 发送窗口打开后按顺序发出排队的帧
+    void flushSendQueue(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state);
+    // 从待确认列表删除已确认的单条消息并更新飞行中统计
+    bool releasePending(ReliableConnState& state, uint32_t sequence);
+    // 放弃单条消息：记录投递失败，从待确认列表删除，腾出的窗口用来发送排队的帧
+    void abandonPending(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, uint32_t sequence,
+                        DeliveryFailure reason);
+    // 记录消息的投递结果，没有回调时什么也不做
+    void recordAcked(const PendingMessage& pending, std::chrono::steady_clock::time_point now);
+    void recordFailed(const DeliveryCallbacksPtr& callbacks, uint32_t sequence, DeliveryFailure reason);
+    // 执行记录下来的投递结果回调
+    void notifyDelivery();
+    // 累计确认：释放不晚于sequence的消息并更新飞行中统计，返回释放的条数
+    size_t releaseCumulative(ReliableConnState& state, uint32_t sequence);
+    // 确认了acked条消息：按AIMD增大窗口
+    void onAcked(ReliableConnState& state, size_t acked);
+    // 确认释放消息后增大窗口并发送排队的帧
+    void afterAcked(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, size_t acked);
+    // 发送数据帧：拷贝到发送缓冲区，填入当前的累计确认号后发送
+    void sendDataFrame(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, const MyProtoFramePtr& frame);
+    // 延迟确认定时器到期
+    void onDelayedAckTimeout(TimerNode* node);
+    // 检测到序列号为sequence的消息丢失：快速重传时窗口减半（快速恢复），超时时窗口降到下限
+    void onLoss(ReliableConnState& state, uint32_t sequence, bool timeout);
+    // 重新发送保存的帧并重新计时
+    void retransmit(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, PendingMessage& pending);
+    // 处理SACK负载：释放已选择确认的消息，对被多次越过的空洞快速重传，返回释放的消息数
+    size_t processSackRanges(const muduo::net::TcpConnectionPtr& conn, ReliableConnState& state, const MyProtoMsg& msg);
+    // 按两个时间轮中最近的到期时间设置loop定时器
+    void armTimer();
+    // 分配连接编号并登记到连接表
+    void registerConnection(const ReliableConnStatePtr& state);
     
-    // 按连接保存已处理的消息序列号，用于去重
-    std::unordered_map<std::string, std::unordered_set<uint32_t>> processedSequences_;
+    muduo::net::EventLoop* loop_; // 所属IO线程
+    std::shared_ptr<bool> alive_; // loop定时器回调通过weak_ptr判断管理器是否还存在
+    std::chrono::steady_clock::time_point epoch_; // 时间轮tick的零点，所有管理器相同，会话换到其他管理器后投递期限仍然有效
+    TimingWheel retransmitWheel_; // 按重传截止时间组织的待确认消息
+    TimingWheel ackWheel_; // 各连接的延迟确认定时器
+    int delayedAckMs_; // 延迟确认的最长时间
+    uint32_t delayedAckMessages_; // 累计多少条按序消息后立即确认
+    muduo::net::Buffer sendBuffer_; // 复用的发送缓冲区，数据帧拷贝到这里填入确认号后发送
+    muduo::net::TcpConnectionPtr batchConn_; // 正在批量发送的连接，没有时为空
+    muduo::net::Buffer batchBuffer_; // 批量发送期间攒下的数据帧
+    uint64_t armedTick_; // 已设置的loop定时器的到期tick，0表示没有
+    MyProtoEncode encoder_; // 协议编码器
+    BackpressureCallback backpressureCallback_; // 背压回调
+    RetryPolicy defaultRetryPolicy_; // 默认重传策略
+    std::unordered_map<uint16_t, RetryPolicy> retryPolicies_; // 按服务号配置的重传策略
+    std::vector<DeliveryEvent> deliveryEvents_; // 待执行的投递结果回调
     
-    // 保存连接名称到连接弱指针的映射，避免循环引用
-    std::unordered_map<std::string, std::weak_ptr<muduo::net::TcpConnection>> connectionMap_;
+    // 所有活动连接的可靠性状态，按连接编号直接下标访问；空位记录在freeIds_中供新连接复用
+    std::vector<ReliableConnStatePtr> connections_;
+    std::vector<uint32_t> freeIds_;
     
     // 发送确认消息
     void sendAck(const muduo::net::TcpConnectionPtr& conn, uint32_t sequence);
-    
-    // 新增：从连接名称获取连接指针
-    muduo::net::TcpConnectionPtr getConnectionByName(const std::string& connName);
-    
-    
 };
 
 #endif // __RELIABLE_MSG_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,185 @@
+#ifndef __SEQUENCE_WINDOW_H
+#define __SEQUENCE_WINDOW_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+
+// 序列号比较使用RFC 1982串行数算术：差值按有符号32位解释，序列号回绕后仍能正确比较
+inline bool seqBefore(uint32_t a, uint32_t b) { return static_cast<int32_t>(a - b) < 0; }
+inline bool seqAfter(uint32_t a, uint32_t b) { return static_cast<int32_t>(a - b) > 0; }
+inline bool seqBeforeOrEqual(uint32_t a, uint32_t b) { return !seqAfter(a, b); }
+
+// 序列号区间[begin, end)
+struct SeqRange {
+    uint32_t begin;
+    uint32_t end;
+};
+
+// 接收端去重窗口（与IPsec/DTLS防重放窗口相同的思路），内存固定，检查O(1)
+// - delivered_：累计水位，不晚于它的序列号都已收到
+// - bits_：水位之上WINDOW_BITS个序列号的乱序到达位图，第i位对应delivered_+1+i
+// 序列号超出窗口右边界时窗口整体前移，被移出窗口的空洞视为已收到（之后再到达按重复丢弃）
+// 水位起点是对端第一个序列号的前一个（新连接从1开始，起点为0；会话换了序列号空间时由HELLO告知），
+// 不能取第一条到达的消息，否则比它早发出而晚到达的消息会被当作重复丢掉
+class DedupWindow {
+public:
+    static const uint32_t WINDOW_BITS = 1024;
+
+    DedupWindow() { reset(); }
+
+    // 清空窗口，base为对端下一个序列号的前一个
+    void reset(uint32_t base = 0) {
+        initialized_ = false;
+        delivered_ = base;
+        pending_ = 0;
+        memset(bits_, 0, sizeof(bits_));
+    }
+
+    // 新序列号返回true并记录下来，重复或已经落在窗口左侧的返回false
+    // 发送端回绕时跳过0（见ReliableConnState::allocateSequence），0视为已收到，水位越过它时不留空洞
+    bool accept(uint32_t seq) {
+        if (seq == 0 || seqBeforeOrEqual(seq, delivered_)) {
+            return false;
+        }
+        initialized_ = true;
+
+        uint32_t offset = seq - delivered_ - 1;
+        if (offset == 0 && pending_ == 0) {
+            // 按序到达的快速路径：位图为空，只推进水位
+            delivered_ = seq;
+            return true;
+        }
+        if (offset >= WINDOW_BITS) {
+            slide(offset - WINDOW_BITS + 1);
+            offset = WINDOW_BITS - 1;
+        }
+
+        uint64_t mask = 1ULL << (offset % 64);
+        uint64_t& word = bits_[offset / 64];
+        if (word & mask) {
+            return false;
+        }
+        word |= mask;
+        pending_++;
+
+        for (;;) {
+            // 从水位开始连续收到的序列号并入水位
+            uint32_t contiguous = 0;
+            for (uint32_t i = 0; i < WORDS; i++) {
+                if (bits_[i] == ~0ULL) {
+                    contiguous += 64;
+                    continue;
+                }
+                contiguous += static_cast<uint32_t>(__builtin_ctzll(~bits_[i]));
+                break;
+            }
+            if (contiguous > 0) {
+                slide(contiguous);
+            }
+            // 水位停在0之前而1已经收到：跳过0继续合并；1还没到时水位停在0之前，确认号不会变成0（表示没有确认）
+            if (delivered_ + 1 != 0 || !(bits_[0] & 2)) {
+                break;
+            }
+            slide(1);
+        }
+        return true;
+    }
+
+    // 是否已经收到过该序列号
+    bool contains(uint32_t seq) const {
+        if (seq == 0) {
+            return true;
+        }
+        if (seqBeforeOrEqual(seq, delivered_)) {
+            return true;
+        }
+        uint32_t offset = seq - delivered_ - 1;
+        if (offset >= WINDOW_BITS) {
+            return false;
+        }
+        return (bits_[offset / 64] >> (offset % 64)) & 1;
+    }
+
+    // 累计确认水位：不晚于它的序列号都已收到
+    uint32_t deliveredUpTo() const { return delivered_; }
+    // 是否收到过消息，没有时累计确认号没有意义
+    bool initialized() const { return initialized_; }
+    // 水位之上是否有乱序到达的消息（即存在空洞）
+    bool hasGaps() const { return pending_ != 0; }
+
+    // 水位之上已收到的连续序列号区间，按序列号从小到大最多输出maxRanges个，返回输出的个数
+    // 用于生成选择确认（SACK），只扫描位图中的非零字
+    size_t receivedRanges(SeqRange* out, size_t maxRanges) const {
+        size_t count = 0;
+        if (pending_ == 0) {
+            return 0;
+        }
+        bool inRange = false;
+        for (uint32_t i = 0; i < WORDS; i++) {
+            uint64_t word = bits_[i];
+            uint32_t bit = 0;
+            while (bit < 64) {
+                // 找到当前状态（在区间内找0，在区间外找1）下一次翻转的位置
+                uint64_t rest = (inRange ? ~word : word) >> bit;
+                if (rest == 0) {
+                    break;
+                }
+                bit += static_cast<uint32_t>(__builtin_ctzll(rest));
+                uint32_t seq = delivered_ + 1 + i * 64 + bit;
+                if (inRange) {
+                    out[count - 1].end = seq;
+                    inRange = false;
+                } else {
+                    if (count == maxRanges) {
+                        return count;
+                    }
+                    out[count].begin = seq;
+                    out[count].end = seq;
+                    count++;
+                    inRange = true;
+                }
+            }
+        }
+        if (inRange) {
+            out[count - 1].end = delivered_ + 1 + WINDOW_BITS;
+        }
+        return count;
+    }
+
+private:
+    static const uint32_t WORDS = WINDOW_BITS / 64;
+
+    // 水位前移n，位图随之右移
+    void slide(uint32_t n) {
+        delivered_ += n;
+        if (n >= WINDOW_BITS) {
+            memset(bits_, 0, sizeof(bits_));
+            pending_ = 0;
+            return;
+        }
+        uint32_t wordShift = n / 64;
+        uint32_t bitShift = n % 64;
+        uint32_t dropped = 0;
+        for (uint32_t i = 0; i < wordShift; i++) {
+            dropped += static_cast<uint32_t>(__builtin_popcountll(bits_[i]));
+        }
+        if (bitShift) {
+            dropped += static_cast<uint32_t>(__builtin_popcountll(bits_[wordShift] & ((1ULL << bitShift) - 1)));
+        }
+        for (uint32_t i = 0; i < WORDS; i++) {
+            uint32_t src = i + wordShift;
+            uint64_t lo = src < WORDS ? bits_[src] : 0;
+            uint64_t hi = src + 1 < WORDS ? bits_[src + 1] : 0;
+            bits_[i] = bitShift ? ((lo >> bitShift) | (hi << (64 - bitShift))) : lo;
+        }
+        pending_ -= dropped;
+    }
+
+    bool initialized_;   // 是否收到过消息
+    uint32_t delivered_; // 累计水位
+    uint32_t pending_;   // 位图中置位的数量，为0时按序到达可走快速路径
+    uint64_t bits_[WORDS];
+};
+
+#endif // __SEQUENCE_WINDOW_H
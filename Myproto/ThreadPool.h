@@ -0,0 +1,171 @@
+#ifndef __THREAD_POOL_H
+#define __THREAD_POOL_H
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <queue>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <memory>
+
+class ThreadPool {
+public:
+  using Task = std::function<void()>;
+
+  // 构造函数：指定线程数和可选的初始化回调
+  explicit ThreadPool(size_t threadNum, Task initCallback = nullptr)
+      : threadNum_(threadNum), running_(false), threadInitCallback_(std::move(initCallback)) {}
+
+  ~ThreadPool() {
+    if (running_) stop();  // 析构时自动停止
+  }
+
+  // 启动线程池（创建 worker 线程）
+  void start() {
+    if (running_) return;
+    running_ = true;
+    workers_.reserve(threadNum_);
+    for (size_t i = 0; i < threadNum_; ++i) {
+      workers_.emplace_back([this]() { workerLoop(); });  // 每个线程绑定 workerLoop
+    }
+  }
+
+  // 提交任务（右值引用版本，支持完美转发）
+  template <typename F>
+  void addTask(F&& task) {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      queue_.emplace(std::forward<F>(task));
+    }
+    cv_.notify_one();  // 解锁后再唤醒，被唤醒的 worker 不会立刻阻塞在锁上
+  }
+
+  // 让出后重新提交（Strand执行完一批后仍有积压时使用）：队列本身是FIFO，与addTask相同
+  template <typename F>
+  void addYieldTask(F&& task) {
+    addTask(std::forward<F>(task));
+  }
+
+  // 停止线程池（等待所有任务执行完毕并回收线程）
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      running_ = false;
+    }
+    cv_.notify_all();  // 唤醒所有线程
+    for (auto& worker : workers_) {
+      if (worker.joinable()) worker.join();
+    }
+    workers_.clear();
+  }
+
+  // 禁止拷贝和移动（线程池不可复制）
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+private:
+  // Worker 线程循环函数
+  void workerLoop() {
+    if (threadInitCallback_) {
+      threadInitCallback_();  // 执行初始化回调
+    }
+
+    while (running_) {  // 循环处理任务，直到 running_ 为 false
+      Task task;
+      // 加锁获取任务
+      std::unique_lock<std::mutex> lock(mtx_);
+      // 等待条件：队列非空 或 线程池停止
+      cv_.wait(lock, [this]() { return !running_ || !queue_.empty(); });
+
+      if (!running_ && queue_.empty()) break;  // 停止且无任务，退出
+
+      if (!queue_.empty()) {
+        task = std::move(queue_.front());  // 任务所有权转移
+        queue_.pop();
+      }
+
+      lock.unlock();  // 解锁后执行任务，避免长时间持有锁
+      if (task) {
+        task();  // 执行任务
+      }
+    }
+  }
+
+private:
+  size_t threadNum_;                  // worker 线程数量
+  std::atomic<bool> running_;         // 线程池运行状态（worker 在锁外读取）
+  std::vector<std::thread> workers_;  // worker 线程集合
+  std::queue<Task> queue_;            // 任务队列
+  std::mutex mtx_;                    // 保护队列和 running_ 的互斥锁
+  std::condition_variable cv_;        // 线程间通知的条件变量
+  Task threadInitCallback_;           // 线程初始化回调（可选）
+};
+
+// 串行执行器（strand）：投递到同一个Strand的任务在线程池中按投递顺序逐个执行，
+// 不同Strand的任务可以在不同worker上并行。同一时刻每个Strand最多占用一个worker
+// Pool可以是ThreadPool或WorkStealingPool，只需要提供addTask
+template <typename Pool>
+class BasicStrand : public std::enable_shared_from_this<BasicStrand<Pool>> {
+public:
+  using Task = std::function<void()>;
+
+  explicit BasicStrand(Pool* pool) : pool_(pool), scheduled_(false) {}
+
+  // 投递任务，可在任意线程调用
+  void post(Task task) {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      queue_.push_back(std::move(task));
+      if (scheduled_) return;  // 已经在线程池中排队或执行，由它顺序执行
+      scheduled_ = true;
+    }
+    schedule();
+  }
+
+  BasicStrand(const BasicStrand&) = delete;
+  BasicStrand& operator=(const BasicStrand&) = delete;
+
+private:
+  void schedule() {
+    std::shared_ptr<BasicStrand> self = this->shared_from_this();
+    pool_->addTask([self]() { self->run(); });
+  }
+
+  // 执行完一批后重新排队，排到线程池中已有任务之后，让其他任务先执行
+  void reschedule() {
+    std::shared_ptr<BasicStrand> self = this->shared_from_this();
+    pool_->addYieldTask([self]() { self->run(); });
+  }
+
+  // 一次取出当前积压的全部任务执行；执行期间又有新任务时重新排队，避免一个繁忙的Strand长期占住worker
+  void run() {
+    std::deque<Task> batch;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      batch.swap(queue_);
+    }
+    for (auto& task : batch) {
+      task();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      if (queue_.empty()) {
+        scheduled_ = false;
+        return;
+      }
+    }
+    reschedule();
+  }
+
+  Pool* pool_;
+  std::mutex mtx_;          // 保护queue_和scheduled_
+  std::deque<Task> queue_;  // 等待执行的任务
+  bool scheduled_;          // 是否已提交到线程池
+};
+
+typedef BasicStrand<ThreadPool> Strand;
+
+#endif // __THREAD_POOL_H
@@ -0,0 +1,217 @@
+#include "TimingWheel.h"
+
+void TimerNode::cancel() {
+    if (wheel) {
+        TimingWheel::unlink(this);
+        wheel->size_--;
+        wheel = nullptr;
+    }
+}
+
+TimingWheel::TimingWheel(uint64_t nowTick) : current_(nowTick), size_(0) {
+    for (int i = 0; i < ROOT_SLOTS; i++) {
+        root_[i].prev = root_[i].next = &root_[i];
+    }
+    for (int l = 0; l < LEVELS - 1; l++) {
+        for (int i = 0; i < LEVEL_SLOTS; i++) {
+            levels_[l][i].prev = levels_[l][i].next = &levels_[l][i];
+        }
+    }
+}
+
+TimingWheel::~TimingWheel() {
+    // 时间轮先于节点销毁时，把节点全部摘下，避免节点析构时访问已释放的时间轮
+    TimerNode* heads[] = {root_, levels_[0], levels_[1], levels_[2]};
+    int counts[] = {ROOT_SLOTS, LEVEL_SLOTS, LEVEL_SLOTS, LEVEL_SLOTS};
+    for (int l = 0; l < LEVELS; l++) {
+        for (int i = 0; i < counts[l]; i++) {
+            TimerNode* head = &heads[l][i];
+            while (head->next != head) {
+                TimerNode* node = head->next;
+                unlink(node);
+                node->wheel = nullptr;
+            }
+        }
+    }
+}
+
+void TimingWheel::link(TimerNode* head, TimerNode* node) {
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+void TimingWheel::unlink(TimerNode* node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = node->next = nullptr;
+}
+
+void TimingWheel::add(TimerNode* node, uint64_t expireTick) {
+    node->cancel();
+    node->expire = expireTick;
+    node->wheel = this;
+    size_++;
+    insert(node);
+}
+
+void TimingWheel::add(TimerNode* node, uint64_t expireTick, uint64_t nowTick) {
+    if (size_ == 0 && nowTick > current_) {
+        current_ = nowTick;
+    }
+    add(node, expireTick);
+}
+
+// 按距离当前tick的远近放到对应层的槽中
+void TimingWheel::insert(TimerNode* node) {
+    uint64_t expire = node->expire;
+    if (expire < current_) {
+        expire = current_; // 已经过期的放到下一个要处理的槽
+    }
+    uint64_t delta = expire - current_;
+    if (delta > MAX_TICKS) {
+        delta = MAX_TICKS;
+        expire = current_ + MAX_TICKS;
+    }
+
+    if (delta < (1ULL << ROOT_BITS)) {
+        link(&root_[expire & (ROOT_SLOTS - 1)], node);
+        return;
+    }
+    for (int l = 0; l < LEVELS - 1; l++) {
+        int shift = ROOT_BITS + (l + 1) * LEVEL_BITS;
+        if (l == LEVELS - 2 || delta < (1ULL << shift)) {
+            int index = static_cast<int>((expire >> (shift - LEVEL_BITS)) & (LEVEL_SLOTS - 1));
+            link(&levels_[l][index], node);
+            return;
+        }
+    }
+}
+
+// 把高层一个槽中的定时器重新分配到更低的层
+void TimingWheel::cascade(int level, int index) {
+    TimerNode list;
+    list.prev = list.next = &list;
+    TimerNode* head = &levels_[level][index];
+    if (head->next == head) {
+        return;
+    }
+    // 整条链表转移到临时表头
+    list.next = head->next;
+    list.prev = head->prev;
+    list.next->prev = &list;
+    list.prev->next = &list;
+    head->prev = head->next = head;
+
+    while (list.next != &list) {
+        TimerNode* node = list.next;
+        unlink(node);
+        insert(node);
+    }
+}
+
+void TimingWheel::advance(uint64_t nowTick, const ExpireCallback& cb) {
+    // 时间轮为空时直接跳到目标时间
+    if (size_ == 0) {
+        if (nowTick + 1 > current_) {
+            current_ = nowTick + 1;
+        }
+        return;
+    }
+
+    while (current_ <= nowTick) {
+        // 中间没有事件的tick直接跳过，跳过的边界上要降级的槽都是空的
+        uint64_t next = nextEventTick();
+        if (next > nowTick) {
+            current_ = nowTick + 1;
+            break;
+        }
+        current_ = next;
+        int index = static_cast<int>(current_ & (ROOT_SLOTS - 1));
+        // 第0层转完一圈时，从上一层取下一个槽降级，依次向上
+        if (index == 0) {
+            for (int l = 0; l < LEVELS - 1; l++) {
+                int slot = static_cast<int>((current_ >> (ROOT_BITS + l * LEVEL_BITS)) & (LEVEL_SLOTS - 1));
+                cascade(l, slot);
+                if (slot != 0) {
+                    break;
+                }
+            }
+        }
+
+        // 取出到期的槽，逐个回调；回调中重新添加的定时器不会落回这个临时链表
+        TimerNode expired;
+        expired.prev = expired.next = &expired;
+        TimerNode* head = &root_[index];
+        if (head->next != head) {
+            expired.next = head->next;
+            expired.prev = head->prev;
+            expired.next->prev = &expired;
+            expired.prev->next = &expired;
+            head->prev = head->next = head;
+        }
+        current_++;
+
+        while (expired.next != &expired) {
+            TimerNode* node = expired.next;
+            unlink(node);
+            node->wheel = nullptr;
+            size_--;
+            cb(node);
+        }
+
+        if (size_ == 0 && current_ <= nowTick) {
+            current_ = nowTick + 1;
+        }
+    }
+}
+
+bool TimingWheel::nextExpiryHint(uint64_t& tick) const {
+    if (size_ == 0) {
+        return false;
+    }
+    tick = nextEventTick();
+    return true;
+}
+
+uint64_t TimingWheel::nextEventTick() const {
+    // 第0层本圈内最近的非空槽，定时器密集时在这里就能返回；
+    // current_正好在边界上时这个边界本身可能要降级，还要和下面各层比较
+    uint64_t index = current_ & (ROOT_SLOTS - 1);
+    uint64_t best = UINT64_MAX;
+    for (uint64_t i = index; i < static_cast<uint64_t>(ROOT_SLOTS); i++) {
+        if (root_[i].next != &root_[i]) {
+            if (index != 0) {
+                return current_ + (i - index);
+            }
+            best = current_ + i;
+            break;
+        }
+    }
+    // 否则取下一圈第0层的非空槽和各层下一次有定时器降级的边界中最早的
+    uint64_t roundEnd = current_ + (ROOT_SLOTS - index);
+    for (uint64_t i = 0; i < index; i++) {
+        if (root_[i].next != &root_[i]) {
+            best = roundEnd + i;
+            break;
+        }
+    }
+    // 第l层的槽在tick为2^(ROOT_BITS+l*LEVEL_BITS)的整数倍时降级，降级的槽号为对应的位段
+    for (int l = 0; l < LEVELS - 1; l++) {
+        int shift = ROOT_BITS + l * LEVEL_BITS;
+        uint64_t boundary = ((current_ + (1ULL << shift) - 1) >> shift) << shift;
+        uint64_t first = (boundary >> shift) & (LEVEL_SLOTS - 1);
+        for (uint64_t k = 0; k < static_cast<uint64_t>(LEVEL_SLOTS); k++) {
+            const TimerNode* head = &levels_[l][(first + k) & (LEVEL_SLOTS - 1)];
+            if (head->next != head) {
+                uint64_t tick = boundary + (k << shift);
+                if (tick < best) {
+                    best = tick;
+                }
+                break;
+            }
+        }
+    }
+    return best;
+}
@@ -0,0 +1,80 @@
+#ifndef __TIMING_WHEEL_H
+#define __TIMING_WHEEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+
+class TimingWheel;
+
+// 挂在时间轮上的定时器节点，由使用方嵌入到自己的对象中（如PendingMessage继承它）
+// 节点析构或调用cancel()时从时间轮上摘除，O(1)；拷贝得到的节点不在时间轮上
+struct TimerNode {
+    TimerNode() : prev(nullptr), next(nullptr), expire(0), wheel(nullptr) {}
+    TimerNode(const TimerNode&) : prev(nullptr), next(nullptr), expire(0), wheel(nullptr) {}
+    TimerNode& operator=(const TimerNode&) { return *this; } // 不拷贝链接关系
+    ~TimerNode() { cancel(); }
+
+    bool scheduled() const { return wheel != nullptr; }
+    void cancel();
+
+    TimerNode* prev;
+    TimerNode* next;
+    uint64_t expire; // 到期时间（tick）
+    TimingWheel* wheel; // 所在的时间轮，不在时间轮上时为nullptr
+};
+
+// 分层时间轮（与Linux内核经典timer wheel相同的结构）
+// 第0层256个槽，每槽1个tick；第1~3层各64个槽，每槽覆盖下一层的一整圈，总范围2^26个tick
+// 添加、取消都是O(1)，推进时只处理到期的槽和需要降级的槽，不遍历所有定时器
+// 非线程安全，只在所属EventLoop线程中使用
+class TimingWheel {
+public:
+    typedef std::function<void(TimerNode*)> ExpireCallback;
+
+    static const int ROOT_BITS = 8;
+    static const int LEVEL_BITS = 6;
+    static const int LEVELS = 4; // 包括第0层
+    static const uint64_t MAX_TICKS = (1ULL << (ROOT_BITS + (LEVELS - 1) * LEVEL_BITS)) - 1;
+
+    explicit TimingWheel(uint64_t nowTick = 0);
+    ~TimingWheel();
+
+    // 添加（或重新调度）定时器，expireTick不晚于当前时间时在下一次推进时到期
+    void add(TimerNode* node, uint64_t expireTick);
+    // 同上，nowTick为调用方的当前时间：时间轮为空时不会被推进，先同步到nowTick，
+    // 避免空闲很久之后按过时的当前时间放置定时器
+    void add(TimerNode* node, uint64_t expireTick, uint64_t nowTick);
+
+    // 推进到nowTick，对每个到期的节点调用cb；调用cb前节点已从时间轮摘除，cb中可以重新add或析构节点
+    // 直接跳过没有定时器到期、也没有定时器需要降级的区间，开销与跨过的时间长短无关
+    void advance(uint64_t nowTick, const ExpireCallback& cb);
+
+    // 下一个可能有定时器到期的tick，用于决定下次唤醒时间；时间轮为空时返回false
+    bool nextExpiryHint(uint64_t& tick) const;
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    uint64_t currentTick() const { return current_; }
+
+private:
+    friend struct TimerNode;
+
+    static const int ROOT_SLOTS = 1 << ROOT_BITS;
+    static const int LEVEL_SLOTS = 1 << LEVEL_BITS;
+
+    void insert(TimerNode* node);
+    // 从current_开始下一个需要处理的tick：第0层有定时器的槽，或者高层有定时器需要降级的边界
+    uint64_t nextEventTick() const;
+    void cascade(int level, int index);
+    static void link(TimerNode* head, TimerNode* node);
+    static void unlink(TimerNode* node);
+
+    // 每个槽是一个带哨兵头节点的双向循环链表
+    TimerNode root_[ROOT_SLOTS];
+    TimerNode levels_[LEVELS - 1][LEVEL_SLOTS];
+    uint64_t current_; // 下一个要处理的tick
+    size_t size_;
+};
+
+#endif // __TIMING_WHEEL_H
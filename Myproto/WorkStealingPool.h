@@ -0,0 +1,388 @@
+#ifndef __WORK_STEALING_POOL_H
+#define __WORK_STEALING_POOL_H
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "ThreadPool.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WS_CPU_RELAX() _mm_pause()
+#else
+#define WS_CPU_RELAX() std::atomic_signal_fence(std::memory_order_seq_cst)
+#endif
+
+// Chase-Lev工作窃取双端队列（Lê等人针对弱内存模型的版本）
+// 所属worker在bottom端push/pop（LIFO，缓存友好），其他worker在top端steal（FIFO）
+// 扩容后的旧数组保留到析构时再释放，窃取方可能还在读旧数组
+template <typename T>
+class WorkStealingDeque {
+public:
+  explicit WorkStealingDeque(int64_t capacity = 1024) : top_(0), bottom_(0) {
+    Array* a = new Array(capacity);
+    arrays_.push_back(std::unique_ptr<Array>(a));
+    array_.store(a, std::memory_order_relaxed);
+  }
+
+  WorkStealingDeque(const WorkStealingDeque&) = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+  // 只能由所属worker调用
+  void push(T x) {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t t = top_.load(std::memory_order_acquire);
+    Array* a = array_.load(std::memory_order_relaxed);
+    if (b - t > a->capacity - 1) {
+      a = grow(a, t, b);
+    }
+    a->put(b, x);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+  }
+
+  // 只能由所属worker调用
+  bool pop(T& x) {
+    int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    Array* a = array_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    if (t > b) {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return false;  // 队列为空
+    }
+    x = a->get(b);
+    if (t == b) {
+      // 最后一个元素，与窃取方竞争
+      bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return won;
+    }
+    return true;
+  }
+
+  // 任意线程调用
+  bool steal(T& x) {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) {
+      return false;
+    }
+    Array* a = array_.load(std::memory_order_acquire);
+    x = a->get(t);
+    return top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+  }
+
+  bool empty() const {
+    return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Array {
+    int64_t capacity;
+    int64_t mask;
+    std::unique_ptr<std::atomic<T>[]> buf;
+
+    explicit Array(int64_t cap) : capacity(cap), mask(cap - 1), buf(new std::atomic<T>[cap]) {}
+    void put(int64_t i, T x) { buf[i & mask].store(x, std::memory_order_relaxed); }
+    T get(int64_t i) const { return buf[i & mask].load(std::memory_order_relaxed); }
+  };
+
+  Array* grow(Array* a, int64_t t, int64_t b) {
+    Array* bigger = new Array(a->capacity * 2);
+    for (int64_t i = t; i < b; ++i) {
+      bigger->put(i, a->get(i));
+    }
+    arrays_.push_back(std::unique_ptr<Array>(bigger));
+    array_.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+
+  // top_和bottom_分别被窃取方和所属worker频繁写，填充到不同的缓存行（C++11的new不保证alignas(64)）
+  std::atomic<int64_t> top_;
+  char padTop_[64 - sizeof(std::atomic<int64_t>)];
+  std::atomic<int64_t> bottom_;
+  char padBottom_[64 - sizeof(std::atomic<int64_t>)];
+  std::atomic<Array*> array_;
+  std::vector<std::unique_ptr<Array>> arrays_;  // 当前数组和扩容前的旧数组，只由所属worker修改
+};
+
+// 有界多生产者多消费者无锁队列（Vyukov），用作外部线程提交任务的注入队列
+template <typename T>
+class MpmcBoundedQueue {
+public:
+  explicit MpmcBoundedQueue(size_t capacity) : mask_(capacity - 1), cells_(new Cell[capacity]), enqueuePos_(0), dequeuePos_(0) {
+    for (size_t i = 0; i < capacity; ++i) {
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpmcBoundedQueue(const MpmcBoundedQueue&) = delete;
+  MpmcBoundedQueue& operator=(const MpmcBoundedQueue&) = delete;
+
+  // 队列满时返回false
+  bool push(T x) {
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = x;
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // 队列空时返回false
+  bool pop(T& x) {
+    size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    x = cell->data;
+    cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return dequeuePos_.load(std::memory_order_relaxed) >= enqueuePos_.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    T data;
+  };
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  char padHead_[64];  // 入队、出队位置分别在不同的缓存行
+  std::atomic<size_t> enqueuePos_;
+  char padMiddle_[64 - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> dequeuePos_;
+  char padTail_[64 - sizeof(std::atomic<size_t>)];
+};
+
+// 工作窃取线程池，接口与ThreadPool相同（start/stop/addTask）
+// - 每个worker有自己的Chase-Lev双端队列，worker内部提交的任务直接进本地队列，不经过任何锁；
+//   Strand执行完一批后的重新排队走addYieldTask进注入队列，不会被同一个worker立即取回
+// - 外部线程（IO线程等）提交的任务进无锁注入队列，注入队列满时提交方自旋等待
+// - 空闲worker先自旋、再让出CPU，最后才在条件变量上休眠；提交方只在有休眠worker时才去加锁唤醒
+class WorkStealingPool {
+public:
+  using Task = std::function<void()>;
+
+  explicit WorkStealingPool(size_t threadNum, Task initCallback = nullptr, size_t injectCapacity = 65536)
+      : threadNum_(threadNum == 0 ? 1 : threadNum),
+        running_(false),
+        threadInitCallback_(std::move(initCallback)),
+        injectQueue_(roundUpPow2(injectCapacity)),
+        sleepers_(0),
+        epoch_(0) {
+    for (size_t i = 0; i < threadNum_; ++i) {
+      queues_.push_back(std::unique_ptr<WorkStealingDeque<Task*>>(new WorkStealingDeque<Task*>()));
+    }
+  }
+
+  ~WorkStealingPool() {
+    if (running_.load()) stop();
+    drain();
+  }
+
+  void start() {
+    if (running_.load()) return;
+    running_.store(true);
+    workers_.reserve(threadNum_);
+    for (size_t i = 0; i < threadNum_; ++i) {
+      workers_.emplace_back([this, i]() { workerLoop(i); });
+    }
+  }
+
+  // 提交任务：在本池的worker线程中提交时放入该worker的本地队列，否则放入注入队列
+  template <typename F>
+  void addTask(F&& task) {
+    Task* t = new Task(std::forward<F>(task));
+    WorkerSlot& slot = currentWorker();
+    if (slot.pool == this) {
+      queues_[slot.index]->push(t);
+    } else {
+      unsigned spins = 0;
+      while (!injectQueue_.push(t)) {
+        backoff(spins++);
+      }
+    }
+    notify();
+  }
+
+  // 让出后重新提交：总是放入注入队列，排在已经排队的任务之后
+  // 放进本地队列会被本worker的LIFO pop立即取回，Strand重新排队就失去了让出worker的意义
+  template <typename F>
+  void addYieldTask(F&& task) {
+    Task* t = new Task(std::forward<F>(task));
+    unsigned spins = 0;
+    while (!injectQueue_.push(t)) {
+      backoff(spins++);
+    }
+    notify();
+  }
+
+  // 停止线程池并回收线程，尚未执行的任务被丢弃（与ThreadPool一致）
+  void stop() {
+    running_.store(false);
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex_);
+      epoch_.fetch_add(1);
+    }
+    sleepCv_.notify_all();
+    for (auto& worker : workers_) {
+      if (worker.joinable()) worker.join();
+    }
+    workers_.clear();
+  }
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+private:
+  struct WorkerSlot {
+    WorkStealingPool* pool;
+    size_t index;
+  };
+
+  static WorkerSlot& currentWorker() {
+    static thread_local WorkerSlot slot = {nullptr, 0};
+    return slot;
+  }
+
+  static size_t roundUpPow2(size_t n) {
+    size_t p = 2;
+    while (p < n) p <<= 1;
+    return p;
+  }
+
+  // 前几次忙等，之后让出CPU
+  static void backoff(unsigned spins) {
+    if (spins < 64) {
+      WS_CPU_RELAX();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  // 有worker在休眠时才加锁递增epoch并唤醒，没有休眠者时提交不再争抢epoch_所在的缓存行
+  void notify() {
+    // 与workerLoop中sleepers_的递增构成全序：这里看不到休眠者，则该worker登记后的复查一定能看到刚提交的任务
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load() > 0) {
+      {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        epoch_.fetch_add(1);
+      }
+      sleepCv_.notify_one();
+    }
+  }
+
+  bool findTask(size_t index, std::minstd_rand& rng, Task*& task) {
+    if (queues_[index]->pop(task)) return true;
+    if (injectQueue_.pop(task)) return true;
+    // 从随机位置开始依次尝试窃取其他worker的任务
+    size_t start = rng() % threadNum_;
+    for (size_t i = 0; i < threadNum_; ++i) {
+      size_t victim = (start + i) % threadNum_;
+      if (victim != index && queues_[victim]->steal(task)) return true;
+    }
+    return false;
+  }
+
+  void workerLoop(size_t index) {
+    currentWorker().pool = this;
+    currentWorker().index = index;
+    if (threadInitCallback_) {
+      threadInitCallback_();
+    }
+
+    std::minstd_rand rng(static_cast<unsigned>(index + 1));
+    unsigned idleRounds = 0;
+    while (running_.load(std::memory_order_relaxed)) {
+      Task* task = nullptr;
+      if (findTask(index, rng, task)) {
+        idleRounds = 0;
+        (*task)();
+        delete task;
+        continue;
+      }
+
+      if (idleRounds < 128) {
+        backoff(idleRounds++);
+        continue;
+      }
+
+      // 休眠前登记并重新检查一次，与notify()中先检查sleepers_、再在锁内递增epoch配合，不会丢失唤醒
+      uint64_t epoch = epoch_.load();
+      sleepers_.fetch_add(1);
+      if (findTask(index, rng, task)) {
+        sleepers_.fetch_sub(1);
+        idleRounds = 0;
+        (*task)();
+        delete task;
+        continue;
+      }
+      {
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        sleepCv_.wait(lock, [this, epoch]() { return epoch_.load() != epoch || !running_.load(); });
+      }
+      sleepers_.fetch_sub(1);
+      idleRounds = 0;
+    }
+  }
+
+  // 释放停止后残留的任务，只在所有worker退出后调用
+  void drain() {
+    Task* task = nullptr;
+    while (injectQueue_.pop(task)) delete task;
+    for (auto& q : queues_) {
+      while (q->pop(task)) delete task;
+    }
+  }
+
+  size_t threadNum_;                                          // worker 线程数量
+  std::atomic<bool> running_;                                 // 线程池运行状态
+  Task threadInitCallback_;                                   // 线程初始化回调（可选）
+  std::vector<std::thread> workers_;                          // worker 线程集合
+  std::vector<std::unique_ptr<WorkStealingDeque<Task*>>> queues_;  // 每个worker的本地队列
+  MpmcBoundedQueue<Task*> injectQueue_;                       // 外部线程提交的任务
+  std::mutex sleepMutex_;                                     // 只用于休眠/唤醒
+  std::condition_variable sleepCv_;
+  std::atomic<int> sleepers_;                                 // 正在休眠或准备休眠的worker数量
+  std::atomic<uint64_t> epoch_;                               // 有休眠者时的提交和stop()递增，休眠的worker据此判断是否被唤醒
+};
+
+typedef BasicStrand<WorkStealingPool> WorkStealingStrand;
+
+#endif // __WORK_STEALING_POOL_H
@@ -1,8 +1,8 @@
 #include <iostream>
 #include <stdlib.h>
 #include "myproto.h"
+#include "CrcEngine.h"
 #include <arpa/inet.h>
-#include <iomanip> // 用于setw和setfill
 
 using namespace std;
 
@@ -21,26 +21,68 @@ const uint32_t TYPE_OFFSET = 13;      // 消息类型字段偏移量
 // 添加CRC计算函数实现
 // 这里使用CRC-16/CCITT-FALSE算法
 uint16_t calculateCRC(const uint8_t* data, size_t length) {
-    uint16_t crc = CRC_INITIAL_VALUE; // 初始值
-    uint16_t polynomial = CRC_POLYNOMIAL; // 多项式
-    
-    for (size_t i = 0; i < length; i++) {
-        crc ^= (uint16_t)(data[i] << 8);
-        for (uint8_t j = 0; j < 8; j++) {
-            if (crc & 0x8000)
-                crc = (crc << 1) ^ polynomial;
-            else
-                crc <<= 1;
-        }
+    return updateCRC(CRC_INITIAL_VALUE, data, length);
+}
+
+// 在已有CRC值基础上继续计算，updateCRC(updateCRC(init, a), b) 等价于对a、b拼接后的数据计算
+// 具体实现由CrcEngine在启动时根据CPU特性选择（查表/slicing/PCLMULQDQ）
+uint16_t updateCRC(uint16_t crc, const uint8_t* data, size_t length) {
+    return CrcEngine::update(crc, data, length);
+}
+
+// 校验一帧完整数据的CRC：发送方计算CRC时CRC字段为0，这里分三段计算，避免拷贝整帧再清零
+bool verifyFrameCRC(const uint8_t* frame, uint32_t frameLen) {
+    static const uint8_t zeroCRC[sizeof(uint16_t)] = {0, 0};
+    uint16_t originalCRC;
+    memcpy(&originalCRC, frame + CRC_OFFSET, sizeof(originalCRC));
+
+    uint16_t crc = updateCRC(CRC_INITIAL_VALUE, frame, CRC_OFFSET);
+    crc = updateCRC(crc, zeroCRC, sizeof(zeroCRC));
+    crc = updateCRC(crc, frame + CRC_OFFSET + sizeof(uint16_t), frameLen - CRC_OFFSET - sizeof(uint16_t));
+
+    if (crc != originalCRC) {
+        cerr << "CRC check failed! Expected: " << crc
+             << " (0x" << hex << crc << dec << ")"
+             << ", Received: " << originalCRC
+             << " (0x" << hex << originalCRC << dec << ")" << endl;
+        return false;
     }
-    
-    return crc;
+    return true;
+}
+void patchPiggybackAck(uint8_t* frame, uint32_t frameLen, uint32_t ack) {
+    uint8_t* trailer = frame + frameLen - MY_PROTO_ACK_TRAILER_SIZE;
+    uint32_t newAck = htonl(ack);
+    uint8_t delta[MY_PROTO_ACK_TRAILER_SIZE];
+    memcpy(delta, &newAck, sizeof(newAck));
+    for (uint32_t i = 0; i < MY_PROTO_ACK_TRAILER_SIZE; i++) {
+        delta[i] ^= trailer[i];
+    }
+    // 改动位于帧尾，之后没有数据，寄存器初始为0时的CRC就是整帧CRC的变化量
+    uint16_t crc;
+    memcpy(&crc, frame + CRC_OFFSET, sizeof(crc));
+    crc ^= updateCRC(0, delta, sizeof(delta));
+    memcpy(frame + CRC_OFFSET, &crc, sizeof(crc));
+    memcpy(trailer, &newAck, sizeof(newAck));
 }
 //----------------------------------公共函数----------------------------------
+//获取JSON消息体，懒解析模式下首次访问时才从原始字节构建
+json& MyProtoMsg::getBody()
+{
+    if (hasRawBody()) {
+        json parsed;
+        if (!parseBody(raw.codec, raw.data, raw.len, parsed)) {
+            throw std::runtime_error("Invalid JSON content in message body");
+        }
+        body = std::move(parsed);
+        raw = MyProtoRawBody(); // JSON已构建，释放对接收缓冲区的引用
+    }
+    return body;
+}
+
 //打印协议数据信息
 void printMyProtoMsg(MyProtoMsg& msg)
 {
-    string jsonStr=msg.body.dump(2);
+    string jsonStr=msg.getBody().dump(2);
 
     // 移除对已删除的magic字段的引用
     printf("Head[version=%d,server=%d,len=%d]\n"
@@ -49,25 +91,25 @@ void printMyProtoMsg(MyProtoMsg& msg)
 }
 
 //----------------------------------协议头封装函数----------------------------------
-//pData指向一个新的内存，需要pMsg中数据对pData进行填充
-void MyProtoEncode::headEncode(uint8_t* pData,MyProtoMsg* pMsg) {    
-    // version - 1字节
-    *(pData + VERSION_OFFSET) = pMsg->head.version;
+//pData指向一个新的内存，用head中的数据对pData进行填充，len为整帧长度
+void MyProtoEncode::headEncode(uint8_t* pData, const MyProtoHead& head, uint32_t len) {    
+    // version - 1字节（高4位为消息体编码，低4位为协议版本号）
+    *(pData + VERSION_OFFSET) = (uint8_t)((head.codec << 4) | (head.version & 0x0F));
     
     // server - 2字节
-    *(uint16_t*)(pData + SERVER_OFFSET) = htons(pMsg->head.server);
+    *(uint16_t*)(pData + SERVER_OFFSET) = htons(head.server);
     
     // len - 4字节
-    *(uint32_t*)(pData + LEN_OFFSET) = htonl(pMsg->head.len);
+    *(uint32_t*)(pData + LEN_OFFSET) = htonl(len);
     
     // crc - 2字节 (暂时置0，后面会填充)
     *(uint16_t*)(pData + CRC_OFFSET) = 0;
     
     // sequence - 4字节
-    *(uint32_t*)(pData + SEQUENCE_OFFSET) = htonl(pMsg->head.sequence);
+    *(uint32_t*)(pData + SEQUENCE_OFFSET) = htonl(head.sequence);
     
-    // type - 1字节
-    *(pData + TYPE_OFFSET) = pMsg->head.type;
+    // type - 1字节（低6位为消息类型，高2位为扩展标志）
+    *(pData + TYPE_OFFSET) = (uint8_t)((head.type & MY_PROTO_TYPE_MASK) | head.flags);
 }
 
 //协议消息体封装函数：传入的pMsg里面只有部分数据，比如Json协议体，服务号，版本号，我们对消息编码后会修改长度信息，这时需要重新编码协议
@@ -75,35 +117,174 @@ void MyProtoEncode::headEncode(uint8_t* pData,MyProtoMsg* pMsg) {
 uint8_t* MyProtoEncode::encode(MyProtoMsg* pMsg, uint32_t& len)
 {
 	uint8_t* pData = NULL;
-    string bodyStr = pMsg->body.dump();
+    // 先编码到线程内复用的Buffer，各种消息体编码共用同一条路径
+    static thread_local muduo::net::Buffer t_frame;
+    t_frame.retrieveAll();
+    if (!encode(pMsg, &t_frame)) {
+        len = 0;
+        return NULL;
+    }
     
+    // 申请内存并拷贝完整的帧
+    len = (uint32_t)t_frame.readableBytes();
+    pData = new uint8_t[len];
+    memcpy(pData, t_frame.peek(), len);
+    
+    return pData;
+}
+
+
+//控制帧快速路径：只编码定长协议头（负载由调用方预先写好）并计算CRC
+void MyProtoEncode::encodeControl(MyProtoMsg* pMsg, uint8_t* pData, uint32_t payloadLen)
+{
+    pMsg->head.len = MY_PROTO_HEAD_SIZE + payloadLen;
+    headEncode(pData, pMsg->head, pMsg->head.len);
+    uint16_t crc = calculateCRC(pData, pMsg->head.len);
+    memcpy(pData + CRC_OFFSET, &crc, sizeof(crc));
+}
+
+namespace {
+// nlohmann序列化输出适配器：把序列化结果直接追加到muduo Buffer（文本用char，二进制编码用uint8_t）
+template<typename CharType>
+class BufferOutputAdapter : public nlohmann::detail::output_adapter_protocol<CharType> {
+public:
+    BufferOutputAdapter() : buf_(NULL) {}
+    void reset(muduo::net::Buffer* buf) { buf_ = buf; }
+    void write_character(CharType c) override { buf_->append(&c, 1); }
+    void write_characters(const CharType* s, std::size_t length) override { buf_->append(s, length); }
+private:
+    muduo::net::Buffer* buf_;
+};
+
+// 每个线程复用一个序列化器，避免每条消息都构造serializer（其内部有512字节的缩进字符串）
+struct BufferSerializer {
+    std::shared_ptr<BufferOutputAdapter<char>> adapter;
+    nlohmann::detail::serializer<json> writer;
+    std::shared_ptr<BufferOutputAdapter<uint8_t>> binaryAdapter;
+    BufferSerializer()
+        : adapter(std::make_shared<BufferOutputAdapter<char>>()), writer(adapter, ' '),
+          binaryAdapter(std::make_shared<BufferOutputAdapter<uint8_t>>()) {}
+};
+}
+
+//按消息体编码把JSON序列化追加到Buffer末尾，编码失败时抛出异常
+void serializeBody(uint8_t codec, const json& body, muduo::net::Buffer* buf)
+{
+    static thread_local BufferSerializer t_serializer;
+    
+    if (codec == MY_PROTO_CODEC_JSON) {
+        t_serializer.adapter->reset(buf);
+        t_serializer.writer.dump(body, false, false, 0);
+        return;
+    }
+    
+    t_serializer.binaryAdapter->reset(buf);
+    nlohmann::detail::binary_writer<json, uint8_t> writer(t_serializer.binaryAdapter);
+    switch (codec) {
+    case MY_PROTO_CODEC_MSGPACK:
+        writer.write_msgpack(body);
+        break;
+    case MY_PROTO_CODEC_CBOR:
+        writer.write_cbor(body);
+        break;
+    case MY_PROTO_CODEC_BSON:
+        writer.write_bson(body);
+        break;
+    case MY_PROTO_CODEC_STRUCT:
+        throw std::invalid_argument("Struct body must be encoded by generated code");
+    default:
+        throw std::invalid_argument("Unsupported body codec: " + std::to_string(codec));
+    }
+}
+
+//直接编码到muduo Buffer末尾，成功时Buffer中追加了一帧完整的数据
+bool MyProtoEncode::encode(MyProtoMsg* pMsg, muduo::net::Buffer* buf)
+{
+    // 需要转码的原始消息体先解析，解析结果缓存在消息里，再次编码时不用重复解析
+    if (pMsg->hasRawBody() && pMsg->raw.codec != pMsg->head.codec) {
+        try {
+            pMsg->getBody();
+        } catch (const std::exception& e) {
+            cerr << "Encode exception: " << e.what() << endl;
+            return false;
+        }
+    }
+    uint32_t len = encodeTo(*pMsg, pMsg->head, buf);
+    if (len == 0) {
+        return false;
+    }
     // 计算消息序列化以后的新长度
-    len = MY_PROTO_HEAD_SIZE + (uint32_t)bodyStr.size();
     pMsg->head.len = len;
+    return true;
+}
+
+//按给定的协议头编码一帧，得到不可变的帧字节
+MyProtoFramePtr MyProtoEncode::encodeFrame(const MyProtoMsg& msg, const MyProtoHead& head)
+{
+    // 先编码到线程内复用的Buffer，再按帧的实际大小拷贝一次
+    static thread_local muduo::net::Buffer t_frame;
+    t_frame.retrieveAll();
+    if (encodeTo(msg, head, &t_frame) == 0) {
+        return MyProtoFramePtr();
+    }
+    return std::make_shared<const std::string>(t_frame.peek(), t_frame.readableBytes());
+}
+
+//编码一帧追加到buf末尾，返回帧长度，失败返回0且buf不变
+uint32_t MyProtoEncode::encodeTo(const MyProtoMsg& msg, const MyProtoHead& head, muduo::net::Buffer* buf)
+{
+    // 预留协议头位置（muduo Buffer头部预留区只有8字节，放不下14字节协议头，所以在可读区末尾预留）
+    size_t frameStart = buf->readableBytes();
+    buf->ensureWritableBytes(MY_PROTO_HEAD_SIZE);
+    buf->hasWritten(MY_PROTO_HEAD_SIZE);
     
-    // 申请内存
-    pData = new uint8_t[len];
+    // 消息体直接序列化到Buffer中；编码相同且未解析过的原始消息体直接拷贝
+    try {
+        if (msg.hasRawBody() && msg.raw.codec == head.codec) {
+            buf->append(msg.raw.data, msg.raw.len);
+        } else if (msg.hasRawBody()) {
+            // 不修改msg，转码时解析到临时对象
+            json body;
+            if (!parseBody(msg.raw.codec, msg.raw.data, msg.raw.len, body)) {
+                throw std::invalid_argument("Invalid raw body");
+            }
+            serializeBody(head.codec, body, buf);
+        } else {
+            serializeBody(head.codec, msg.body, buf);
+        }
+    } catch (const std::exception& e) {
+        cerr << "Encode exception: " << e.what() << endl;
+        buf->unwrite(buf->readableBytes() - frameStart); // 回滚已写入的半帧
+        return 0;
+    }
+    
+    // 帧尾扩展字段：关联ID、捎带确认号（捎带确认号必须在最后）
+    if (head.flags & MY_PROTO_FLAG_CORRELATION) {
+        uint32_t correlation = htonl(head.correlation);
+        buf->append(&correlation, sizeof(correlation));
+    }
+    if (head.flags & MY_PROTO_FLAG_PIGGYBACK_ACK) {
+        uint32_t ack = htonl(head.ack);
+        buf->append(&ack, sizeof(ack));
+    }
     
-    // 编码协议头
-    headEncode(pData, pMsg);
+    uint32_t len = (uint32_t)(buf->readableBytes() - frameStart);
     
-    // 打包协议体
-    memcpy(pData + MY_PROTO_HEAD_SIZE, bodyStr.data(), bodyStr.size());
+    // 序列化过程中Buffer可能扩容，写完后再取帧的起始地址
+    uint8_t* pData = reinterpret_cast<uint8_t*>(const_cast<char*>(buf->peek())) + frameStart;
+    headEncode(pData, head, len);
     
     // 计算并填充CRC值
     uint16_t crc = calculateCRC(pData, len);
-    // 直接将主机字节序的CRC值写入到CRC_OFFSET位置
-    *(uint16_t*)(pData + CRC_OFFSET) = crc;
-    
-    return pData;
+    memcpy(pData + CRC_OFFSET, &crc, sizeof(crc));
+    return len;
 }
 
-
 //----------------------------------协议解析类----------------------------------
-//初始化协议解析状态
+//初始化协议解析状态：解析是无状态的（不完整的帧留在调用方缓冲区中），只需丢弃还没取走的消息
 void MyProtoDecode::init()
 {
-	mCurParserStatus = ON_PARSER_INIT;
+	clear();
 }
 
 //清空解析好的消息队列
@@ -132,253 +313,282 @@ std::shared_ptr<MyProtoMsg> MyProtoDecode::front()
 	return mMsgQ.front();
 }
 
-//从网络字节流中解析出来协议消息,len由socket函数recv返回
-// 修复parser方法中的消息边界处理逻辑
-bool MyProtoDecode::parser(void* data, size_t len) {
+//原地解析：只读取data指向的字节流，不做任何拷贝，完整的帧直接解析后放入消息队列
+//末尾不完整的帧不计入consumed，由调用方保留到下一次数据到达后重新解析
+bool MyProtoDecode::parserInPlace(const uint8_t* data, size_t len, size_t& consumed,
+                                  const std::shared_ptr<const void>& owner) {
+    const std::shared_ptr<const void> noOwner;
+    const std::shared_ptr<const void>& bodyOwner = mLazyBody ? owner : noOwner;
+    consumed = 0;
     try {
-        if (len <= 0)
-            return false;
-
-        uint32_t curLen = 0; // 用于保存未解析的网络字节流长度
-        uint32_t parserLen = 0; // 保存vector中已经被解析完成的字节流
-        uint8_t* curData = NULL; // 指向data,当前未解析的网络字节流
-
-        curData = (uint8_t*)data;
-        
-        // 将当前要解析的网络字节流写入到vector中    
-        while(len--) {
-            mCurReserved.push_back(*curData);
-            ++curData;
-        }
-
-        curLen = mCurReserved.size();
-        curData = (uint8_t*)&mCurReserved[0]; // 获取数据首地址
-
-        // 只要还有未解析的网络字节流，就持续解析
-        while(curLen > 0) {
-            bool parserBreak = false;//用于标记解析过程是否需要中断等待更多数据
-            parserLen = 0; // 重置已解析长度
-
-            // 解析头部
-            if (ON_PARSER_INIT == mCurParserStatus) {
-                if (!parserHead(&curData, curLen, parserLen, parserBreak)) {
-                    // 解析头部失败，清理已解析的数据
-                    if (parserLen > 0) {
-                        mCurReserved.erase(mCurReserved.begin(), mCurReserved.begin() + parserLen);
-                    }
-                    return false;
-                }
-                if (parserBreak) {
-                    break; // 退出循环，等待下一次数据到达
-                }
+        while (len - consumed >= MY_PROTO_HEAD_SIZE) {
+            const uint8_t* pFrame = data + consumed;
+            std::shared_ptr<MyProtoMsg> pMsg = std::make_shared<MyProtoMsg>();
+            
+            // 协议头非法时无法确定帧边界，字节流已经失去同步
+            if (!headDecode(pFrame, pMsg->head)) {
+                return false;
             }
             
-            // 解析完成协议头，开始解析协议体
-            if (ON_PARSER_HEAD == mCurParserStatus) {
-                if (!parserBody(&curData, curLen, parserLen, parserBreak)) {
-                    // 解析体部失败，清理已解析的数据
-                    if (parserLen > 0) {
-                        mCurReserved.erase(mCurReserved.begin(), mCurReserved.begin() + parserLen);
-                    }
-                    return false;
-                }
-                if (parserBreak) {
-                    break;
-                }
-                // 成功解析完消息体后，设置状态为解析完成
-                mCurParserStatus = ON_PARSER_BODY;
+            // 消息体还没有完全到达，等待更多数据
+            if (len - consumed < pMsg->head.len) {
+                break;
             }
-
-            // 如果成功解析了消息，就把他放入消息队列
-            if (ON_PARSER_BODY == mCurParserStatus) {
-                std::shared_ptr<MyProtoMsg> pMsg = std::make_shared<MyProtoMsg>();
-                *pMsg = mCurMsg;
+            
+            // 帧边界已知，消息体校验失败只丢弃这一帧，继续解析后面的帧
+            if (bodyDecode(pFrame, *pMsg, bodyOwner)) {
                 mMsgQ.push(pMsg);
-                
-                // 重置解析状态，准备解析下一条消息
-                mCurParserStatus = ON_PARSER_INIT;
-               
-                
-                // 计算已解析的总长度并从缓冲区移除
-                uint32_t totalParsed = MY_PROTO_HEAD_SIZE + (mCurMsg.head.len - MY_PROTO_HEAD_SIZE);
-                if (totalParsed <= mCurReserved.size()) {
-                    mCurReserved.erase(mCurReserved.begin(), mCurReserved.begin() + totalParsed);
-                }
-                
-                // 更新剩余数据
-                curLen = mCurReserved.size();
-                curData = (curLen > 0) ? (uint8_t*)&mCurReserved[0] : NULL;
+            } else {
+                cerr << "Dropping invalid frame, sequence: " << pMsg->head.sequence << endl;
             }
+            consumed += pMsg->head.len;
         }
     } catch (const std::exception& e) {
-        // 记录异常并重置解析状态，防止程序崩溃
         cerr << "Parser exception: " << e.what() << endl;
-        init(); // 重置解析状态
-        return false;
-    } catch (...) {
-        cerr << "Unknown parser exception" << endl;
-        init();
         return false;
     }
     return true;
 }
 
-// 用于解析消息头
-bool MyProtoDecode::parserHead(uint8_t** curData, uint32_t& curLen, uint32_t& parserLen, bool& parserBreak) {
-    // 检查当前数据长度是否足够解析头部
-    if (curLen < MY_PROTO_HEAD_SIZE) {
-        cout<<"[DEBUG] Not enough data for header, need " << MY_PROTO_HEAD_SIZE << ", have " << curLen << endl;
-        parserBreak = true;
-        return true;
-    }
-
-    // 获取当前解析位置
-    uint8_t* pData = *curData;
-    
-    // 添加调试日志，打印原始字节数据
-    cout << "[DEBUG] Raw header bytes (first 14 bytes): ";
-    for (uint32_t i = 0; i < MY_PROTO_HEAD_SIZE && i < curLen; i++) {
-        printf("%02X ", pData[i]);
-    }
-    cout << endl;
-    
-    // 解析版本号（头部第一个字节）
-    mCurMsg.head.version = pData[VERSION_OFFSET];
+//解析并校验协议头，pData至少包含MY_PROTO_HEAD_SIZE个字节
+bool MyProtoDecode::headDecode(const uint8_t* pData, MyProtoHead& head) {
+    // 解析版本号（头部第一个字节，高4位为消息体编码）
+    head.version = pData[VERSION_OFFSET] & 0x0F;
+    head.codec = pData[VERSION_OFFSET] >> 4;
     
     // 验证版本号是否支持
-    if (mCurMsg.head.version != 0 && mCurMsg.head.version != 1) {
-        cerr << "Unsupported protocol version: " << static_cast<int>(mCurMsg.head.version) << endl;
+    if (head.version != 0 && head.version != 1) {
+        cerr << "Unsupported protocol version: " << static_cast<int>(head.version) << endl;
         return false;
     }
     
-    // 解析服务号（接下来的两个字节）
-    mCurMsg.head.server = ntohs(*(uint16_t*)(pData + SERVER_OFFSET));
-    cout << "[DEBUG] Parsed server: " << mCurMsg.head.server << endl;
-    
-    // 解析协议消息体长度（接下来的四个字节）
-    mCurMsg.head.len = ntohl(*(uint32_t*)(pData + LEN_OFFSET));
-    
-    // 解析CRC校验值（接下来的两个字节）
-    mCurMsg.head.crc = *(uint16_t*)(pData + CRC_OFFSET);
-    
-    // 解析序列号（接下来的四个字节）
-    mCurMsg.head.sequence = ntohl(*(uint32_t*)(pData + SEQUENCE_OFFSET));
-    cout << "[DEBUG] Parsed sequence: " << mCurMsg.head.sequence << endl;
+    // 验证消息体编码是否支持
+    if (head.codec >= MY_PROTO_CODEC_COUNT) {
+        cerr << "Unsupported body codec: " << static_cast<int>(head.codec) << endl;
+        return false;
+    }
     
-    // 解析消息类型（最后一个字节）
-    mCurMsg.head.type = pData[TYPE_OFFSET];
-    cout << "[DEBUG] Parsed type: " << static_cast<int>(mCurMsg.head.type) << " (0x" << hex << static_cast<int>(mCurMsg.head.type) << dec << ")" << endl;
+    // 多字节字段在缓冲区中不一定对齐，用memcpy读取
+    uint16_t server, crc;
+    uint32_t len, sequence;
+    memcpy(&server, pData + SERVER_OFFSET, sizeof(server));
+    memcpy(&len, pData + LEN_OFFSET, sizeof(len));
+    memcpy(&crc, pData + CRC_OFFSET, sizeof(crc));
+    memcpy(&sequence, pData + SEQUENCE_OFFSET, sizeof(sequence));
+    head.server = ntohs(server);
+    head.len = ntohl(len);
+    head.crc = crc; // CRC按发送方主机字节序原样保存
+    head.sequence = ntohl(sequence);
+    head.type = pData[TYPE_OFFSET] & MY_PROTO_TYPE_MASK;
+    head.flags = pData[TYPE_OFFSET] & ~MY_PROTO_TYPE_MASK;
     
-    // 合并消息类型验证逻辑，允许更多类型值
-    if (mCurMsg.head.type != 0 && mCurMsg.head.type != 1) {
-        cout << "[WARNING] Non-standard message type: " << static_cast<int>(mCurMsg.head.type) << ", but continuing processing" << endl;
-        // 不再返回false，而是继续处理消息
+    // 判断数据长度是否超过指定的最大大小，防止缓冲区溢出
+    if (head.len > MY_PROTO_MAX_SIZE) {
+        cerr << "Message length exceeds maximum size: " << head.len << endl;
+        return false;
     }
     
-    // 判断数据长度是否超过指定的最大大小，防止缓冲区溢出
-    if (mCurMsg.head.len > MY_PROTO_MAX_SIZE) {
-        cerr << "Message length exceeds maximum size: " << mCurMsg.head.len << endl;
+    // 验证消息长度是否合法（至少包含头部和帧尾扩展字段）
+    if (head.len < MY_PROTO_HEAD_SIZE + frameTrailerSize(head)) {
+        cerr << "Invalid message length: " << head.len << endl;
         return false;
     }
+    return true;
+}
+
+//读取帧尾扩展字段，pTrailer指向消息体之后
+void MyProtoDecode::decodeTrailer(const uint8_t* pTrailer, MyProtoHead& head) {
+    head.correlation = 0;
+    head.ack = 0;
+    if (head.flags & MY_PROTO_FLAG_CORRELATION) {
+        uint32_t correlation;
+        memcpy(&correlation, pTrailer, sizeof(correlation));
+        head.correlation = ntohl(correlation);
+        pTrailer += MY_PROTO_CORRELATION_SIZE;
+    }
+    if (head.flags & MY_PROTO_FLAG_PIGGYBACK_ACK) {
+        uint32_t ack;
+        memcpy(&ack, pTrailer, sizeof(ack));
+        head.ack = ntohl(ack);
+    }
+}
+
+//校验CRC并解析协议体，pFrame指向一帧完整数据的起始位置，msg.head已由headDecode填充
+//owner非空时为懒解析：只记录消息体在缓冲区中的位置，JSON在首次getBody()时构建
+bool MyProtoDecode::bodyDecode(const uint8_t* pFrame, MyProtoMsg& msg, const std::shared_ptr<const void>& owner) {
+    uint32_t bodyLen = frameBodySize(msg.head);
     
-    // 验证消息长度是否合法（至少包含头部）
-    if (mCurMsg.head.len < MY_PROTO_HEAD_SIZE) {
-        cerr << "Invalid message length: " << mCurMsg.head.len << endl;
+    if (!verifyFrameCRC(pFrame, msg.head.len)) {
         return false;
     }
+    decodeTrailer(pFrame + MY_PROTO_HEAD_SIZE + bodyLen, msg.head);
     
-    // 更新解析指针位置，移动到头部之后的下一个位置
-    *curData = pData + MY_PROTO_HEAD_SIZE;
-    curLen -= MY_PROTO_HEAD_SIZE;
-    parserLen += MY_PROTO_HEAD_SIZE;
+    // 控制帧不携带JSON，校验完CRC即可
+    bool control = isControlFrame(msg.head);
+    if (control && bodyLen == 0) {
+        return true;
+    }
     
-    // 设置解析状态为解析头部完成
-    mCurParserStatus = ON_PARSER_HEAD;
+    const char* pBody = reinterpret_cast<const char*>(pFrame + MY_PROTO_HEAD_SIZE);
+    if (!owner && (control || msg.head.codec == MY_PROTO_CODEC_STRUCT)) {
+        // 结构体消息体只能由生成的代码解码，控制帧负载由可靠层解析，非懒解析模式下拷贝一份原始字节
+        std::shared_ptr<std::string> copy = std::make_shared<std::string>(pBody, bodyLen);
+        msg.raw.owner = copy;
+        msg.raw.data = copy->data();
+        msg.raw.len = bodyLen;
+        msg.raw.codec = msg.head.codec;
+        return true;
+    }
+    if (owner) {
+        msg.raw.owner = owner;
+        msg.raw.data = pBody;
+        msg.raw.len = bodyLen;
+        msg.raw.codec = msg.head.codec;
+        return true;
+    }
     
+    // 直接从缓冲区单遍解析并校验，不构造临时string
+    if (!parseBody(msg.head.codec, pBody, bodyLen, msg.body)) {
+        cerr << "Invalid JSON content in message body" << endl;
+        return false;
+    }
     return true;
 }
 
-// 用于解析消息体
-bool MyProtoDecode::parserBody(uint8_t** curData, uint32_t& curLen, uint32_t& parserLen, bool& parserBreak) {
-    // 获取消息体长度
-    uint32_t bodyLen = mCurMsg.head.len - MY_PROTO_HEAD_SIZE;
-    
-    // 检查当前数据长度是否足够解析消息体
-    if (curLen < bodyLen) {
-        parserBreak = true;
-        return true;
+namespace {
+// 键名只允许字母、数字和下划线
+bool isValidJsonKey(const string& key) {
+    for (size_t i = 0; i < key.size(); i++) {
+        char c = key[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_')) {
+            return false;
+        }
     }
-    
-    try {
-        // 将消息体内容解析为JSON
-        string bodyStr((char*)*curData, bodyLen);
-        
-        // 验证bodyStr是否为空
-        if (bodyStr.empty()) {
-            mCurMsg.body = json::object(); // 空JSON对象
-        } else {
-            mCurMsg.body = json::parse(bodyStr);
+    return true;
+}
+
+// 带校验的SAX处理器：在json_sax_dom_parser构建DOM的同时执行validateJsonContent的规则
+// 顶层必须是非空对象，顶层键名只允许字母数字下划线，顶层字符串值不超过MY_PROTO_MAX_JSON_STRING_LEN
+// 任一回调返回false时sax_parse立即停止，剩余部分不再解析和分配
+class ValidatingSax {
+public:
+    explicit ValidatingSax(json& result) : dom_(result, false), depth_(0), topLevelKeys_(0) {}
+
+    bool null() { return checkInsideObject() && dom_.null(); }
+    bool boolean(bool val) { return checkInsideObject() && dom_.boolean(val); }
+    bool number_integer(json::number_integer_t val) { return checkInsideObject() && dom_.number_integer(val); }
+    bool number_unsigned(json::number_unsigned_t val) { return checkInsideObject() && dom_.number_unsigned(val); }
+    bool number_float(json::number_float_t val, const json::string_t& s) { return checkInsideObject() && dom_.number_float(val, s); }
+
+    bool string(json::string_t& val) {
+        if (!checkInsideObject()) {
+            return false;
         }
-        
-        // 验证JSON内容
-        if (!validateJsonContent(mCurMsg.body)) {
-            cerr << "Invalid JSON content in message body" << endl;
+        if (depth_ == 1 && val.size() > MY_PROTO_MAX_JSON_STRING_LEN) {
+            cerr << "String value too long for key: " << lastKey_ << endl;
             return false;
         }
-        
-        // 完整的CRC校验实现
-       // 1. 获取原始消息起始位置
-        // 计算从保留缓冲区开始到当前数据的偏移量
-        uint32_t offsetToCurrentData = mCurReserved.size() - curLen;
-        uint8_t* originalMsgStart = (uint8_t*)&mCurReserved[0] + offsetToCurrentData - MY_PROTO_HEAD_SIZE;
-        uint32_t totalMsgLen = MY_PROTO_HEAD_SIZE + bodyLen;
-         // 2. 保存原始CRC值
-        uint16_t originalCRC = *(uint16_t*)(originalMsgStart + CRC_OFFSET);
-        // 3. 创建一个临时副本并将CRC字段置0
-        vector<uint8_t> tempMsgData(originalMsgStart, originalMsgStart + totalMsgLen);
-        memset(&tempMsgData[CRC_OFFSET], 0, sizeof(uint16_t)); // 将CRC字段置0
-        
-        // 4. 计算CRC
-        uint16_t calculatedCRC = calculateCRC(tempMsgData.data(), totalMsgLen);
-        
-        // 5. 验证CRC
-        if (calculatedCRC != originalCRC) {
-            cerr << "CRC check failed! Expected: " << calculatedCRC 
-                 << " (0x" << hex << calculatedCRC << dec << ")"
-                 << ", Received: " << originalCRC 
-                 << " (0x" << hex << originalCRC << dec << ")" << endl;
-            
-            // 添加调试信息：打印消息头前几个字节
-            cerr << "[DEBUG] First 16 bytes of message: ";
-            for (int i = 0; i < min(16, (int)totalMsgLen); i++) {
-                cerr << hex << setw(2) << setfill('0') << (int)originalMsgStart[i] << " ";
+        return dom_.string(val);
+    }
+
+    bool start_object(size_t len) {
+        ++depth_;
+        return dom_.start_object(len);
+    }
+
+    bool key(json::string_t& val) {
+        if (depth_ == 1) {
+            if (!isValidJsonKey(val)) {
+                cerr << "Invalid character in JSON key: " << val << endl;
+                return false;
             }
-            cerr << dec << endl;
-            
+            lastKey_ = val;
+            ++topLevelKeys_;
+        }
+        return dom_.key(val);
+    }
+
+    bool end_object() {
+        if (--depth_ == 0 && topLevelKeys_ == 0) {
+            cerr << "Empty JSON content" << endl;
             return false;
         }
-        cout << "[DEBUG] CRC check passed. Calculated: " << calculatedCRC << ", Original: " << originalCRC << endl;
-        // 如果是数据消息（type=0），则设置解析状态为解析完成
-        if (mCurMsg.head.type == 0) {
-            mCurParserStatus = ON_PARSER_BODY;
+        return dom_.end_object();
+    }
+
+    bool start_array(size_t len) {
+        if (!checkInsideObject()) {
+            return false;
         }
-        
-        // 更新解析指针位置，移动到消息体之后的下一个位置
-        (*curData) += bodyLen;
-        // 更新剩余数据长度
-        curLen -= bodyLen;
-        // 更新已解析的数据长度
-        parserLen += bodyLen;
-        
-        // 返回解析成功
-        return true;
-    } catch (const json::exception& e) {
-        cerr << "JSON parse error: " << e.what() << endl;
+        ++depth_;
+        return dom_.start_array(len);
+    }
+
+    bool end_array() {
+        --depth_;
+        return dom_.end_array();
+    }
+
+    bool parse_error(size_t /*position*/, const std::string& /*lastToken*/, const nlohmann::detail::exception& ex) {
+        cerr << "JSON parse error: " << ex.what() << endl;
         return false;
+    }
+
+private:
+    // 消息体顶层只能是对象
+    bool checkInsideObject() {
+        if (depth_ == 0) {
+            cerr << "JSON body must be an object" << endl;
+            return false;
+        }
+        return true;
+    }
+
+    nlohmann::detail::json_sax_dom_parser<json> dom_;
+    int depth_; // 当前嵌套深度，顶层对象内部为1
+    size_t topLevelKeys_; // 顶层对象的键数量
+    std::string lastKey_; // 最近的顶层键名，用于错误日志
+};
+}
+
+bool parseJsonBody(const char* data, size_t len, json& out) {
+    return parseBody(MY_PROTO_CODEC_JSON, data, len, out);
+}
+
+bool parseBody(uint8_t codec, const char* data, size_t len, json& out) {
+    json result;
+    ValidatingSax sax(result);
+    bool ok = false;
+    try {
+        switch (codec) {
+        case MY_PROTO_CODEC_JSON:
+            ok = json::sax_parse(data, data + len, &sax);
+            break;
+        case MY_PROTO_CODEC_MSGPACK:
+            ok = json::sax_parse(nlohmann::detail::input_adapter(data, data + len), &sax, nlohmann::detail::input_format_t::msgpack);
+            break;
+        case MY_PROTO_CODEC_CBOR:
+            ok = json::sax_parse(nlohmann::detail::input_adapter(data, data + len), &sax, nlohmann::detail::input_format_t::cbor);
+            break;
+        case MY_PROTO_CODEC_BSON:
+            ok = json::sax_parse(nlohmann::detail::input_adapter(data, data + len), &sax, nlohmann::detail::input_format_t::bson);
+            break;
+        case MY_PROTO_CODEC_STRUCT:
+            cerr << "Struct body has no JSON form, decode it with the generated type" << endl;
+            break;
+        default:
+            cerr << "Unsupported body codec: " << static_cast<int>(codec) << endl;
+            break;
+        }
     } catch (const std::exception& e) {
-        cerr << "Message body parse exception: " << e.what() << endl;
+        cerr << "Body parse exception: " << e.what() << endl;
+        ok = false;
+    }
+    if (!ok) {
         return false;
     }
+    out = std::move(result);
+    return true;
 }
 
 // 替换结构化绑定为传统的迭代方式
@@ -404,13 +614,13 @@ bool validateJsonContent(const json& j) {
             const json& value = it.value();
             
             // 检查键名是否合法（例如不包含特殊字符）
-            if (key.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_") != string::npos) {
+            if (!isValidJsonKey(key)) {
                 cerr << "Invalid character in JSON key: " << key << endl;
                 return false;
             }
             
-            // 检查字符串值长度是否超过限制
-            if (value.is_string() && value.get<string>().length() > 1024) { // 假设1024是最大长度
+            // 检查字符串值长度是否超过限制（取引用，不拷贝字符串）
+            if (value.is_string() && value.get_ref<const string&>().length() > MY_PROTO_MAX_JSON_STRING_LEN) {
                 cerr << "String value too long for key: " << key << endl;
                 return false;
             }
@@ -8,12 +8,14 @@
 #include <iostream>
 #include <cstring>
 #include "json.hpp"
+#include "muduo/net/Buffer.h"
 
 using namespace std;
 using json = nlohmann::json;
 
 const uint32_t MY_PROTO_MAX_SIZE = 10*1024*1024; //10M协议中数据最大
 const uint32_t MY_PROTO_HEAD_SIZE = 14; // 协议头大小由15改为14（移除了1字节的magic字段）
+const uint32_t MY_PROTO_MAX_JSON_STRING_LEN = 1024; // 消息体顶层字符串值的最大长度
 
 // 添加CRC相关常量定义
 extern const uint16_t CRC_INITIAL_VALUE; // CRC初始值
@@ -27,33 +29,123 @@ extern const uint32_t CRC_OFFSET;       // CRC字段偏移量
 extern const uint32_t SEQUENCE_OFFSET;  // 序列号字段偏移量
 extern const uint32_t TYPE_OFFSET;      // 消息类型字段偏移量
 
-typedef enum MyProtoParserStatus //协议解析的状态
+typedef enum MyProtoMsgType //协议类型
 {
-	ON_PARSER_INIT = 0, //初始状态
-	ON_PARSER_HEAD = 1, //解析头部
-	ON_PARSER_BODY = 2, //解析数据
-}MyProtoParserStatus;
+	MY_PROTO_TYPE_DATA = 0, //数据消息
+	MY_PROTO_TYPE_ACK = 1, //单条确认
+	MY_PROTO_TYPE_BATCH_ACK = 2, //批量确认（序列号为累计确认号，不晚于它的消息都已收到）
+	MY_PROTO_TYPE_SACK = 3, //选择确认：序列号为累计确认号，消息体为累计确认号之后已收到的序列号区间（见SackFrame）
+	MY_PROTO_TYPE_HELLO = 4, //会话握手：连接建立时交换会话ID和累计确认号，重连后据此恢复会话（见SESSION_HELLO_SIZE）
+}MyProtoMsgType;
+
+// 线路上type字节的低6位为消息类型，高2位为扩展标志
+// 两个扩展字段都在消息体之后，依次为关联ID、捎带确认号；捎带确认号始终在帧的最后（见patchPiggybackAck）
+const uint8_t MY_PROTO_TYPE_MASK = 0x3F;
+const uint8_t MY_PROTO_FLAG_PIGGYBACK_ACK = 0x80; // 帧尾附带4字节累计确认号（捎带确认），不需要单独发确认帧
+const uint8_t MY_PROTO_FLAG_CORRELATION = 0x40; // 帧尾附带4字节关联ID，响应原样带回请求的关联ID
+const uint32_t MY_PROTO_ACK_TRAILER_SIZE = 4; // 捎带确认号的长度（网络字节序）
+const uint32_t MY_PROTO_CORRELATION_SIZE = 4; // 关联ID的长度（网络字节序）
+
+typedef enum MyProtoBodyCodec //消息体编码，线路上占version字节的高4位，低4位为协议版本号
+{
+	MY_PROTO_CODEC_JSON = 0, //JSON文本（默认，与旧版本兼容）
+	MY_PROTO_CODEC_MSGPACK = 1, //MessagePack
+	MY_PROTO_CODEC_CBOR = 2, //CBOR
+	MY_PROTO_CODEC_BSON = 3, //BSON（顶层必须是对象）
+	MY_PROTO_CODEC_STRUCT = 4, //由schema生成的定长布局二进制结构体（见MyProtoStruct.h），没有JSON形式
+	MY_PROTO_CODEC_COUNT,
+}MyProtoBodyCodec;
 
 //协议头部 - 添加packed属性强制紧凑布局
 struct MyProtoHead {
-    uint8_t version; //协议版本号
-    uint16_t server; //协议复用的服务号
-    uint32_t len; //协议长度
-    uint16_t crc; //CRC校验值
-    uint32_t sequence; //协议序列号
-    uint8_t type; //协议类型 0-数据 1确认消息
+    uint8_t version = 0; //协议版本号
+    uint16_t server = 0; //协议复用的服务号
+    uint32_t len = 0; //协议长度
+    uint16_t crc = 0; //CRC校验值
+    uint32_t sequence = 0; //协议序列号
+    uint8_t type = 0; //协议类型 0-数据 1确认消息
+    uint8_t codec = MY_PROTO_CODEC_JSON; //消息体编码，与version共用线路上的第一个字节
+    uint8_t flags = 0; //扩展标志，与type共用线路上的最后一个字节
+    uint32_t ack = 0; //捎带的累计确认号，flags带MY_PROTO_FLAG_PIGGYBACK_ACK时有效（线路上位于帧尾），0表示没有
+    uint32_t correlation = 0; //关联ID，flags带MY_PROTO_FLAG_CORRELATION时有效，用于匹配请求和响应
 } __attribute__((packed)); // 重要：强制结构体紧凑布局
 
+//原始消息体字节：引用计数的接收缓冲区切片，owner保证data在消息存活期间有效
+struct MyProtoRawBody
+{
+	std::shared_ptr<const void> owner; //持有底层接收缓冲区
+	const char* data = nullptr; //消息体起始位置
+	size_t len = 0; //消息体长度
+	uint8_t codec = MY_PROTO_CODEC_JSON; //原始字节的编码
+};
+
 //协议消息体
 struct MyProtoMsg
 {
 	MyProtoHead head; //协议头
-	json body; //协议体
+	json body; //协议体（懒解析模式下接收到的消息在首次调用getBody()前为空，读取请用getBody()）
+	MyProtoRawBody raw; //懒解析模式下保存的原始消息体字节，构建JSON后清空
+
+	//是否还持有未解析的原始消息体
+	bool hasRawBody() const { return raw.data != nullptr; }
+	//获取JSON消息体，懒解析模式下首次访问时才解析并校验，失败时抛出异常
+	json& getBody();
 };
 
+//编码完成的整帧字节：引用计数、不可修改，可以被多处共享并原样多次发送（如重传）
+typedef std::shared_ptr<const std::string> MyProtoFramePtr;
+
+// 帧尾扩展字段（关联ID、捎带确认号）的总长度
+inline uint32_t frameTrailerSize(const MyProtoHead& head)
+{
+	return ((head.flags & MY_PROTO_FLAG_CORRELATION) ? MY_PROTO_CORRELATION_SIZE : 0) +
+	       ((head.flags & MY_PROTO_FLAG_PIGGYBACK_ACK) ? MY_PROTO_ACK_TRAILER_SIZE : 0);
+}
+
+// 设置请求的关联ID
+inline void setCorrelation(MyProtoHead& head, uint32_t correlation)
+{
+	head.flags |= MY_PROTO_FLAG_CORRELATION;
+	head.correlation = correlation;
+}
+
+// 响应带回请求的关联ID（请求没有关联ID时什么也不做），发起方据此把响应交给对应的调用
+inline void replyCorrelation(MyProtoHead& reply, const MyProtoHead& request)
+{
+	if (request.flags & MY_PROTO_FLAG_CORRELATION) {
+		setCorrelation(reply, request.correlation);
+	}
+}
+
+// 消息体长度：帧长度去掉协议头和帧尾扩展字段
+inline uint32_t frameBodySize(const MyProtoHead& head)
+{
+	return head.len - MY_PROTO_HEAD_SIZE - frameTrailerSize(head);
+}
+
+// 控制帧（确认等）：没有JSON消息体，或者类型不是数据消息，编解码时只处理定长协议头
+// 控制帧可以带二进制负载（如SACK区间），解码后原样保存在raw中，不做JSON解析
+inline bool isControlFrame(const MyProtoHead& head)
+{
+	return head.type != MY_PROTO_TYPE_DATA || frameBodySize(head) == 0;
+}
+
 // 增加CRC计算函数声明
 uint16_t calculateCRC(const uint8_t* data, size_t length);
+// 在已有CRC值基础上继续计算，用于分段计算（例如头部和消息体分开）
+uint16_t updateCRC(uint16_t crc, const uint8_t* data, size_t length);
+// 校验一帧完整数据的CRC（计算时CRC字段按0处理，不修改原始数据）
+bool verifyFrameCRC(const uint8_t* frame, uint32_t frameLen);
+// 改写已编码帧的捎带确认号（帧必须带MY_PROTO_FLAG_PIGGYBACK_ACK），CRC按改动的4个字节增量更新，不重新计算整帧
+// 确认号在帧尾，CRC-16/CCITT-FALSE是线性的：新CRC = 旧CRC ^ CRC0(新旧确认号的异或)，与帧长度无关
+void patchPiggybackAck(uint8_t* frame, uint32_t frameLen, uint32_t ack);
 bool validateJsonContent(const json& j);
+// 单遍解析并校验JSON消息体：边解析边执行validateJsonContent的规则，发现非法内容立即停止，不再构建剩余的树
+bool parseJsonBody(const char* data, size_t len, json& out);
+// 按消息体编码单遍解析并校验（JSON/MessagePack/CBOR/BSON共用同一套校验规则）
+bool parseBody(uint8_t codec, const char* data, size_t len, json& out);
+// 按消息体编码把JSON序列化追加到Buffer末尾
+void serializeBody(uint8_t codec, const json& body, muduo::net::Buffer* buf);
 //公共函数
 //打印协议数据信息
 void printMyProtoMsg(MyProtoMsg& msg);
@@ -64,9 +156,19 @@ class MyProtoEncode
 public:
 	//协议消息体封装函数：传入的pMsg里面只有部分数据，比如Json协议体，服务号，我们对消息编码后会修改长度信息，这时需要重新编码协议
 	uint8_t* encode(MyProtoMsg* pMsg, uint32_t& len); //返回长度信息，用于后面socket发送数据
+	//直接编码到muduo Buffer末尾：先预留协议头位置，JSON直接序列化进Buffer，再原地填充协议头和CRC
+	//不产生临时string和额外的内存拷贝，Buffer可以直接交给TcpConnection::send
+	bool encode(MyProtoMsg* pMsg, muduo::net::Buffer* buf);
+	//控制帧快速路径：只编码定长协议头，不做任何JSON处理，pData至少有MY_PROTO_HEAD_SIZE字节（通常是栈上数组）
+	//payloadLen不为0时，控制帧的二进制负载已经写在pData + MY_PROTO_HEAD_SIZE处，一起计算长度和CRC
+	void encodeControl(MyProtoMsg* pMsg, uint8_t* pData, uint32_t payloadLen = 0);
+	//按给定协议头（len字段忽略）编码msg得到一帧不可变的字节，不修改msg，失败返回空
+	MyProtoFramePtr encodeFrame(const MyProtoMsg& msg, const MyProtoHead& head);
 private:
-	//协议头封装函数
-	void headEncode(uint8_t* pData,MyProtoMsg* pMsg);
+	//协议头封装函数，len为整帧长度
+	void headEncode(uint8_t* pData, const MyProtoHead& head, uint32_t len);
+	//编码一帧追加到buf末尾，返回帧长度，失败返回0
+	uint32_t encodeTo(const MyProtoMsg& msg, const MyProtoHead& head, muduo::net::Buffer* buf);
 };
 
 
@@ -75,10 +177,7 @@ private:
 class MyProtoDecode
 {
 private:
-	MyProtoMsg mCurMsg; //当前解析中的协议消息体
 	queue<std::shared_ptr<MyProtoMsg>> mMsgQ; //解析好的协议消息队列
-	vector<uint8_t> mCurReserved; //未解析的网络字节流，可以缓存所有没有解析的数据（按字节）
-	MyProtoParserStatus mCurParserStatus; //当前接受方解析状态
 public:
 	void init(); //初始化协议解析状态
 	void clear(); //清空解析好的消息队列
@@ -86,12 +185,20 @@ public:
 	void pop();  //出队一个消息
 
 	std::shared_ptr<MyProtoMsg> front(); //获取一个解析好的消息
-	bool parser(void* data,size_t len); //从网络字节流中解析出来协议消息，len是网络中的字节流长度，通过socket可以获取
+	//原地解析模式：直接在调用方的缓冲区（如muduo Buffer的peek()）上解析完整的帧，不拷贝字节流
+	//consumed返回已解析完成的字节数，调用方只需retrieve这部分，末尾不完整的帧留在缓冲区中
+	//返回false表示协议头非法，字节流已无法重新同步
+	//懒解析模式下owner需持有data所在的缓冲区，消息只引用其中的消息体字节，不立即构建JSON
+	bool parserInPlace(const uint8_t* data,size_t len,size_t& consumed,
+		const std::shared_ptr<const void>& owner = std::shared_ptr<const void>());
+	void setLazyBody(bool lazy) { mLazyBody = lazy; } //设置懒解析模式
+	bool lazyBody() const { return mLazyBody; }
 private:
-	bool parserHead(uint8_t** curData,uint32_t& curLen,
-		uint32_t& parserLen,bool& parserBreak); //用于解析消息头
-	bool parserBody(uint8_t** curData,uint32_t& curLen,
-		uint32_t& parserLen,bool& parserBreak); //用于解析消息体
+	bool mLazyBody = false; //懒解析模式：消息体保留原始字节，首次访问时才解析
+	static bool headDecode(const uint8_t* pData,MyProtoHead& head); //解析并校验协议头
+	//校验CRC并解析协议体，pFrame指向帧起始位置；owner非空时只记录原始字节
+	static bool bodyDecode(const uint8_t* pFrame,MyProtoMsg& msg,const std::shared_ptr<const void>& owner);
+	static void decodeTrailer(const uint8_t* pTrailer,MyProtoHead& head); //读取帧尾扩展字段（关联ID、捎带确认号）
 };
 
 #endif
\ No newline at end of file
@@ -23,14 +23,18 @@ MyProtoServer::MyProtoServer(EventLoop* loop, const muduo::net::InetAddress& lis
         std::bind(&ConnectionHandler::onWriteComplete, connectionHandler_, std::placeholders::_1)
     );
     
-    // 设置定时器，定期检查超时消息
-    loop->runEvery(2, std::bind(&MyProtoServer::onTimeout, this));
+    // 每个IO线程启动时创建各自的可靠消息管理器（线程数为0时在主循环上执行）
+    server_.setThreadInitCallback(std::bind(&MyProtoServer::onThreadInit, this, std::placeholders::_1));
 }
 
 MyProtoServer::~MyProtoServer() {
     stop();
 }
 
+void MyProtoServer::setThreadNum(int numThreads) {
+    server_.setThreadNum(numThreads);
+}
+
 void MyProtoServer::start() {
     std::cout << "Starting MyProtoServer on " << server_.ipPort() << std::endl;
     server_.start();
@@ -46,6 +50,27 @@ std::shared_ptr<BusinessHandler> MyProtoServer::getBusinessHandler() {
     return businessHandler_;
 }
 
-void MyProtoServer::onTimeout() {
-    connectionHandler_->checkTimeoutMessages();
+void MyProtoServer::setLazyBody(bool lazy) {
+    connectionHandler_->setLazyBody(lazy);
+}
+
+void MyProtoServer::setWorkerThreads(size_t numThreads) {
+    connectionHandler_->setWorkerThreads(numThreads);
+}
+
+void MyProtoServer::setBackpressureCallback(const ConnectionHandler::BackpressureCallback& cb) {
+    connectionHandler_->setBackpressureCallback(cb);
+}
+
+void MyProtoServer::setDelayedAck(int delayMs, uint32_t maxMessages) {
+    connectionHandler_->setDelayedAck(delayMs, maxMessages);
+}
+
+void MyProtoServer::setRetryPolicy(uint16_t server, const RetryPolicy& policy) {
+    connectionHandler_->setRetryPolicy(server, policy);
+}
+
+void MyProtoServer::onThreadInit(EventLoop* loop) {
+    // 重传由管理器内部的时间轮按每条消息的超时时间在该loop上触发，不再定期轮询
+    connectionHandler_->initLoop(loop);
 }
\ No newline at end of file
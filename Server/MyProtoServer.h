@@ -13,19 +13,37 @@ public:
     MyProtoServer(EventLoop* loop, const muduo::net::InetAddress& listenAddr, const std::string& nameArg);
     ~MyProtoServer();
     
+    // 设置IO线程数（需在start之前调用），0表示所有连接都在主循环中处理
+    void setThreadNum(int numThreads);
+    
     void start();
     void stop();
     
     // 获取业务处理器，用于注册业务逻辑
     std::shared_ptr<BusinessHandler> getBusinessHandler();
     
+    // 设置消息体懒解析（需在start之前调用）
+    void setLazyBody(bool lazy);
+    
+    // 设置业务处理线程数（需在start之前调用），0表示业务处理在IO线程中执行
+    void setWorkerThreads(size_t numThreads);
+    
+    // 设置背压回调（需在start之前调用），连接的发送队列积压时通知业务层暂停发送
+    void setBackpressureCallback(const ConnectionHandler::BackpressureCallback& cb);
+    
+    // 设置延迟确认（需在start之前调用）：最多延迟delayMs毫秒或累计maxMessages条消息后发送确认
+    void setDelayedAck(int delayMs, uint32_t maxMessages);
+    
+    // 设置服务号server的重传策略（需在start之前调用），例如实时性要求高的服务设置较短的投递期限
+    void setRetryPolicy(uint16_t server, const RetryPolicy& policy);
+    
 private:
     muduo::net::TcpServer server_;
     std::shared_ptr<ConnectionHandler> connectionHandler_;
     std::shared_ptr<BusinessHandler> businessHandler_;
     
-    // 定时器回调，用于检查超时消息
-    void onTimeout();
+    // IO线程初始化回调：创建该线程的可靠消息管理器
+    void onThreadInit(EventLoop* loop);
 };
 
 #endif // __MY_PROTO_SERVER_H
\ No newline at end of file
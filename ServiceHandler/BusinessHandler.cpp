@@ -39,7 +39,8 @@ void BusinessHandler::handleMessage(const TcpConnectionPtr& conn, const std::sha
             json errorResponse;
             errorResponse["error"] = e.what();
             errorResponse["code"] = -1;
-            sendResponse(conn, msg->head.server, errorResponse);
+            // 错误响应作为请求的回复，带回关联ID，异步调用方可以立即拿到错误而不必等到超时
+            sendReply(conn, *msg, errorResponse);
         }
     } else {
         std::cerr << "No handler registered for serverId: " << msg->head.server << std::endl;
@@ -55,14 +56,11 @@ void BusinessHandler::handleMessage(const TcpConnectionPtr& conn, const std::sha
  * @param conn TCP连接指针，指向需要发送响应的客户端连接
  * @param serverId 服务器ID，标识响应来自哪个服务模块
  * @param responseBody 响应体数据，使用json格式存储的业务响应内容
- * @return uint32_t 发送结果，成功返回非零值（通常是发送的字节数），失败返回0
+ * @param codec 响应消息体的编码方式，默认为JSON文本
+ * @return uint32_t 发送结果，成功返回提交编号（见ConnectionHandler::sendMessage），失败返回0
  */
-uint32_t BusinessHandler::sendResponse(const TcpConnectionPtr& conn, uint16_t serverId, const json& responseBody) {
-    // 检查连接处理器是否已设置
-    if (!connectionHandler_) {
-        return 0;
-    }
-    
+uint32_t BusinessHandler::sendResponse(const TcpConnectionPtr& conn, uint16_t serverId, const json& responseBody,
+                                      uint8_t codec) {
     // 创建响应消息对象
     MyProtoMsg responseMsg;
     // 设置消息版本号
@@ -74,9 +72,32 @@ uint32_t BusinessHandler::sendResponse(const TcpConnectionPtr& conn, uint16_t se
     responseMsg.head.sequence = 0; // 将由ReliableMsgManager分配
     // 设置消息类型为数据消息
     responseMsg.head.type = 0; // 数据消息
+    // 设置消息体编码
+    responseMsg.head.codec = codec;
     // 设置响应体
     responseMsg.body = responseBody;
     
+    return sendResponseMsg(conn, responseMsg);
+}
+
+uint32_t BusinessHandler::sendReply(const TcpConnectionPtr& conn, const MyProtoMsg& request, const json& responseBody) {
+    MyProtoMsg responseMsg;
+    responseMsg.head.version = 1;
+    responseMsg.head.server = request.head.server;
+    responseMsg.head.type = 0; // 数据消息
+    // 使用与请求相同的消息体编码，结构体消息没有通用的JSON形式，回复用JSON
+    responseMsg.head.codec = request.head.codec == MY_PROTO_CODEC_STRUCT ? static_cast<uint8_t>(MY_PROTO_CODEC_JSON) : request.head.codec;
+    replyCorrelation(responseMsg.head, request.head);
+    responseMsg.body = responseBody;
+    return sendResponseMsg(conn, responseMsg);
+}
+
+uint32_t BusinessHandler::sendResponseMsg(const TcpConnectionPtr& conn, const MyProtoMsg& responseMsg) {
+    // 检查连接处理器是否已设置
+    if (!connectionHandler_) {
+        return 0;
+    }
+    
     // 通过连接处理器发送消息并返回发送结果
     return connectionHandler_->sendMessage(conn, responseMsg);
 }
\ No newline at end of file
@@ -4,8 +4,10 @@
 #include <memory>
 #include <unordered_map>
 #include <functional>
+#include <stdexcept>
 #include <muduo/net/TcpConnection.h>
 #include "../Myproto/myproto.h"
+#include "../Myproto/MyProtoStruct.h"
 
 class ConnectionHandler;
 
@@ -13,6 +15,9 @@ class BusinessHandler {
 public:
     using TcpConnectionPtr = muduo::net::TcpConnectionPtr;
     using MessageHandler = std::function<void(const TcpConnectionPtr&, const std::shared_ptr<MyProtoMsg>&, ConnectionHandler*)>;
+    // 生成的结构体消息的处理函数，直接拿到解码好的结构体
+    template<typename T>
+    using TypedHandler = std::function<void(const TcpConnectionPtr&, const T&, ConnectionHandler*)>;
     
     BusinessHandler();
     ~BusinessHandler();
@@ -22,13 +27,52 @@ public:
     // 注册业务处理函数
     void registerHandler(uint16_t serverId, const MessageHandler& handler);
     
+    // 注册生成的结构体消息的处理函数，服务号取T::kServerId；用法：registerHandler<TelemetryReport>(fn)
+    template<typename T>
+    void registerHandler(const TypedHandler<T>& handler) {
+        registerHandler(T::kServerId, [handler](const TcpConnectionPtr& conn, const std::shared_ptr<MyProtoMsg>& msg, ConnectionHandler* connHandler) {
+            T value;
+            if (!myproto_struct::decodeMsg(*msg, value)) {
+                throw std::runtime_error(std::string("Failed to decode ") + T::kName);
+            }
+            handler(conn, value, connHandler);
+        });
+    }
+    
     // 处理消息入口
     void handleMessage(const TcpConnectionPtr& conn, const std::shared_ptr<MyProtoMsg>& msg);
     
     // 发送响应消息
-    uint32_t sendResponse(const TcpConnectionPtr& conn, uint16_t serverId, const json& responseBody);
+    uint32_t sendResponse(const TcpConnectionPtr& conn, uint16_t serverId, const json& responseBody,
+                          uint8_t codec = MY_PROTO_CODEC_JSON);
+    
+    // 发送生成的结构体消息，服务号取T::kServerId；编码失败（字符串字段超长）返回0
+    template<typename T>
+    uint32_t sendResponse(const TcpConnectionPtr& conn, const T& value) {
+        MyProtoMsg responseMsg;
+        if (!myproto_struct::makeMsg(value, responseMsg)) {
+            return 0;
+        }
+        return sendResponseMsg(conn, responseMsg);
+    }
+    
+    // 回复请求：服务号和编码取自请求，并带回请求的关联ID，对端通过MyProtoClient::asyncCall发起的调用据此完成
+    uint32_t sendReply(const TcpConnectionPtr& conn, const MyProtoMsg& request, const json& responseBody);
+    
+    // 以生成的结构体消息回复请求；编码失败（字符串字段超长）返回0
+    template<typename T>
+    uint32_t sendReply(const TcpConnectionPtr& conn, const MyProtoMsg& request, const T& value) {
+        MyProtoMsg responseMsg;
+        if (!myproto_struct::makeMsg(value, responseMsg)) {
+            return 0;
+        }
+        replyCorrelation(responseMsg.head, request.head);
+        return sendResponseMsg(conn, responseMsg);
+    }
 
 private:
+    uint32_t sendResponseMsg(const TcpConnectionPtr& conn, const MyProtoMsg& responseMsg);
+    
     std::shared_ptr<ConnectionHandler> connectionHandler_;
     //消息路由机制
     /*
@@ -1,12 +1,14 @@
 #include <iostream>
 #include <signal.h>
 #include "MyProtoServer.h"
+#include "messages.gen.h" // 由Schema/messages.schema生成
 #include "muduo/net/EventLoop.h"  // 添加EventLoop的头文件
 #include <fstream>
 #include <iomanip>
 #include <chrono>
 #include <sstream>
 #include <mutex>
+#include <thread>
 using namespace std;
 using namespace muduo;
 using namespace muduo::net;
@@ -26,7 +28,7 @@ void signalHandler(int sig) {
 // 业务处理示例
 void handleEchoRequest(const TcpConnectionPtr& conn, const std::shared_ptr<MyProtoMsg>& msg, ConnectionHandler* connHandler) {
     std::cout << "[EchoHandler] handleEchoRequest called, connection: " << conn->name() << std::endl;
-    std::cout << "[EchoHandler] Message body: " << msg->body.dump() << std::endl;
+    std::cout << "[EchoHandler] Message body: " << msg->getBody().dump() << std::endl;
     try
     {
         auto now=chrono::system_clock::now();
@@ -64,7 +66,7 @@ void handleEchoRequest(const TcpConnectionPtr& conn, const std::shared_ptr<MyPro
             // 组合元数据和消息体
             json fileContent;
             fileContent["metadata"] = metadata;
-            fileContent["data"] = msg->body;
+            fileContent["data"] = msg->getBody();
 
             // 保存到文件
             file << std::setw(4) << fileContent << std::endl;
@@ -79,7 +81,7 @@ void handleEchoRequest(const TcpConnectionPtr& conn, const std::shared_ptr<MyPro
     
     
     json responseBody;
-    responseBody["echo"] = msg->body;
+    responseBody["echo"] = msg->getBody();
     responseBody["status"] = "success";
     
     MyProtoMsg responseMsg;
@@ -88,12 +90,28 @@ void handleEchoRequest(const TcpConnectionPtr& conn, const std::shared_ptr<MyPro
     responseMsg.head.server = msg->head.server; // 与请求相同的服务ID
     responseMsg.head.sequence = 0;
     responseMsg.head.type = 0;
+    responseMsg.head.codec = msg->head.codec; // 按请求的编码回复
+    replyCorrelation(responseMsg.head, msg->head); // 带回请求的关联ID，客户端的asyncCall据此匹配响应
     responseMsg.body = responseBody;
     
     std::cout << "[EchoHandler] Sending response: " << responseMsg.body.dump() << std::endl;
     connHandler->sendMessage(conn, responseMsg);
 }
 
+// 遥测上报：结构体消息，处理函数直接拿到解码好的TelemetryReport
+void handleTelemetryReport(const TcpConnectionPtr& conn, const TelemetryReport& report, BusinessHandler* businessHandler) {
+    if (report.alarm) {
+        std::cout << "[TelemetryHandler] Alarm from device " << report.deviceId << " at " << report.location
+                  << ", temperature: " << report.temperature << ", humidity: " << report.humidity << std::endl;
+    }
+    
+    TelemetryAck ack;
+    ack.deviceId = report.deviceId;
+    ack.timestamp = report.timestamp;
+    ack.accepted = true;
+    businessHandler->sendResponse(conn, ack);
+}
+
 int main(int argc, char* argv[]) {
     // 解析命令行参数
     int port = 8888;
@@ -101,6 +119,16 @@ int main(int argc, char* argv[]) {
         port = atoi(argv[1]);
 
     }
+    // IO线程数，默认每个CPU核一个
+    int threadNum = static_cast<int>(std::thread::hardware_concurrency());
+    if (argc > 2) {
+        threadNum = atoi(argv[2]);
+    }
+    // 业务处理线程数，回显服务每条消息都要写文件，不放在IO线程中执行
+    int workerNum = 4;
+    if (argc > 3) {
+        workerNum = atoi(argv[3]);
+    }
     
     // 设置信号处理
     signal(SIGINT, signalHandler);
@@ -113,9 +141,20 @@ int main(int argc, char* argv[]) {
     InetAddress listenAddr(port);
     MyProtoServer server(&loop, listenAddr, "MyProtoServer");
     
+    server.setThreadNum(threadNum);
+    server.setWorkerThreads(workerNum > 0 ? workerNum : 0);
+    
+    // 消息体懒解析：重复消息和没有注册处理函数的消息不再解析JSON
+    server.setLazyBody(true);
+    
     // 注册业务处理函数
     auto businessHandler = server.getBusinessHandler();
     businessHandler->registerHandler(1, handleEchoRequest); // 注册回显服务
+    BusinessHandler* bh = businessHandler.get();
+    businessHandler->registerHandler<TelemetryReport>(
+        [bh](const TcpConnectionPtr& conn, const TelemetryReport& report, ConnectionHandler*) {
+            handleTelemetryReport(conn, report, bh);
+        }); // 注册遥测服务
     
     // 启动服务器
     server.start();
@@ -0,0 +1,18 @@
+#ifndef __TEST_CHECK_H
+#define __TEST_CHECK_H
+
+#include <cstdio>
+#include <cstdlib>
+
+// 单元测试用的检查宏：条件不成立时打印位置并以非0退出，不受NDEBUG影响（Release构建下同样生效）
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            std::exit(1);                                                           \
+        }                                                                           \
+    } while (0)
+
+#define CHECK_EQ(a, b) CHECK((a) == (b))
+
+#endif // __TEST_CHECK_H
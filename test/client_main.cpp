@@ -33,9 +33,19 @@ void sendTestMessage(MyProtoClient& client) {
     cout << "sendTestMessage called, msg body: " << body.dump() << endl;
     
     // 发送消息
-    uint32_t seq = client.sendMessage(msg);
+    uint32_t ticket = client.sendMessage(msg);
     
-    cout << "Sent message with sequence: " << seq << endl;
+    cout << "Sent message with ticket: " << ticket << endl;
+    
+    // 同一个请求再以异步调用的方式发出，回显响应带回关联ID后在loop线程中回调
+    uint32_t callId = client.asyncCall(1, body, 3000, [](RpcStatus status, const shared_ptr<MyProtoMsg>& response) {
+        if (status == RPC_OK) {
+            cout << "Call " << response->head.correlation << " completed: " << response->getBody().dump() << endl;
+        } else {
+            cout << "Call failed, status: " << status << endl;
+        }
+    });
+    cout << "Started call: " << callId << endl;
 }
 
 
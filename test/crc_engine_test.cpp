@@ -0,0 +1,65 @@
+// CrcEngine单元测试：各实现与逐位参考实现对比，覆盖随机长度、非对齐起点和分段增量计算
+#include <cstdlib>
+#include <vector>
+#include "CrcEngine.h"
+#include "TestCheck.h"
+
+namespace {
+
+const uint16_t CRC_INIT = 0xFFFF;
+
+// 标准校验值：CRC-16/CCITT-FALSE("123456789") = 0x29B1
+void testCheckValue() {
+    const uint8_t data[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    for (int i = 0; i < CRC_IMPL_COUNT; i++) {
+        CrcImpl impl = static_cast<CrcImpl>(i);
+        if (!CrcEngine::isSupported(impl)) {
+            continue;
+        }
+        CHECK_EQ(CrcEngine::update(impl, CRC_INIT, data, sizeof(data)), 0x29B1);
+    }
+    CHECK_EQ(CrcEngine::update(CRC_INIT, data, sizeof(data)), 0x29B1);
+}
+
+// 随机长度和起点，整段计算以及在随机位置分成两段、三段增量计算，结果都与参考实现一致
+void testAgainstBitwise() {
+    std::srand(20240601);
+    std::vector<uint8_t> buf(4096 + 64);
+    for (int round = 0; round < 2000; round++) {
+        for (size_t i = 0; i < buf.size(); i++) {
+            buf[i] = static_cast<uint8_t>(std::rand());
+        }
+        // 短数据更容易暴露尾部处理的问题，多取一些
+        size_t len = round % 2 == 0 ? std::rand() % 64 : std::rand() % 4097;
+        const uint8_t* data = buf.data() + std::rand() % 64;
+        uint16_t expected = CrcEngine::update(CRC_IMPL_BITWISE, CRC_INIT, data, len);
+        size_t split1 = len == 0 ? 0 : std::rand() % (len + 1);
+        size_t split2 = split1 + (len == split1 ? 0 : std::rand() % (len - split1 + 1));
+
+        for (int i = 0; i < CRC_IMPL_COUNT; i++) {
+            CrcImpl impl = static_cast<CrcImpl>(i);
+            if (!CrcEngine::isSupported(impl)) {
+                continue;
+            }
+            CHECK_EQ(CrcEngine::update(impl, CRC_INIT, data, len), expected);
+            uint16_t crc = CrcEngine::update(impl, CRC_INIT, data, split1);
+            CHECK_EQ(CrcEngine::update(impl, crc, data + split1, len - split1), expected);
+            crc = CrcEngine::update(impl, crc, data + split1, split2 - split1);
+            CHECK_EQ(CrcEngine::update(impl, crc, data + split2, len - split2), expected);
+        }
+        CHECK_EQ(CrcEngine::update(CRC_INIT, data, len), expected);
+    }
+}
+
+} // namespace
+
+int main() {
+    testCheckValue();
+    testAgainstBitwise();
+    for (int i = 0; i < CRC_IMPL_COUNT; i++) {
+        CrcImpl impl = static_cast<CrcImpl>(i);
+        std::printf("%s: %s\n", CrcEngine::implName(impl), CrcEngine::isSupported(impl) ? "checked" : "not supported");
+    }
+    std::printf("crc_engine_test passed (active: %s)\n", CrcEngine::implName(CrcEngine::activeImpl()));
+    return 0;
+}
@@ -0,0 +1,116 @@
+// PendingRing单元测试：登记、删除、累计释放、扩容时保留定时器、序列号回绕
+#include <vector>
+#include "PendingRing.h"
+#include "TestCheck.h"
+
+namespace {
+
+struct Entry : public TimerNode {
+    int value = 0;
+};
+
+std::vector<uint32_t> sequences(PendingRing<Entry>& ring) {
+    std::vector<uint32_t> out;
+    ring.forEach([&out](uint32_t seq, Entry&) { out.push_back(seq); });
+    return out;
+}
+
+void testInsertFindErase() {
+    PendingRing<Entry> ring;
+    CHECK(ring.empty());
+    for (uint32_t s = 1; s <= 10; s++) {
+        Entry* e = ring.insert(s);
+        CHECK(e != nullptr);
+        e->value = static_cast<int>(s);
+    }
+    CHECK_EQ(ring.size(), 10u);
+    CHECK_EQ(ring.baseSequence(), 1u);
+    CHECK_EQ(ring.endSequence(), 11u);
+    CHECK_EQ(ring.find(7)->value, 7);
+    CHECK(ring.find(11) == nullptr);
+
+    // 删除中间的不影响环头，删除环头时跳过已经删除的空槽
+    CHECK(ring.erase(2));
+    CHECK(!ring.erase(2));
+    CHECK_EQ(ring.baseSequence(), 1u);
+    CHECK(ring.erase(1));
+    CHECK_EQ(ring.baseSequence(), 3u);
+    CHECK_EQ(ring.size(), 8u);
+
+    // 已经确认过（早于环头）的序列号不能再登记
+    CHECK(ring.insert(1) == nullptr);
+}
+
+void testReleaseUpTo() {
+    PendingRing<Entry> ring;
+    for (uint32_t s = 1; s <= 20; s++) {
+        ring.insert(s);
+    }
+    ring.erase(5);
+    int released = 0;
+    CHECK_EQ(ring.releaseUpTo(8, [&released](Entry&) { released++; }), 7u);
+    CHECK_EQ(released, 7);
+    CHECK_EQ(ring.baseSequence(), 9u);
+    CHECK_EQ(ring.releaseUpTo(3), 0u);
+    // 确认号超出已登记范围时只释放已登记的部分
+    CHECK_EQ(ring.releaseUpTo(100), 12u);
+    CHECK(ring.empty());
+    CHECK(ring.find(20) == nullptr);
+}
+
+// 扩容搬移后，原来挂在时间轮上的节点按原到期时间重新挂上
+void testGrowKeepsTimers() {
+    TimingWheel wheel;
+    PendingRing<Entry> ring;
+    for (uint32_t s = 1; s <= 4; s++) {
+        Entry* e = ring.insert(s);
+        e->value = static_cast<int>(s);
+        wheel.add(e, 10 + s);
+    }
+    for (uint32_t s = 5; s <= 1000; s++) {
+        ring.insert(s);
+    }
+    CHECK_EQ(wheel.size(), 4u);
+    CHECK(ring.find(3)->scheduled());
+    CHECK_EQ(ring.find(3)->expire, 13u);
+
+    std::vector<int> fired;
+    wheel.advance(100, [&fired](TimerNode* node) { fired.push_back(static_cast<Entry*>(node)->value); });
+    CHECK_EQ(fired.size(), 4u);
+    CHECK(fired[0] == 1 && fired[3] == 4);
+
+    // 删除消息同时取消定时器
+    wheel.add(ring.find(500), 200);
+    CHECK(ring.erase(500));
+    CHECK(wheel.empty());
+}
+
+// 序列号跨过2^32回绕，跳过的0留空槽
+void testWrap() {
+    PendingRing<Entry> ring;
+    for (uint32_t s = 0xFFFFFFF0u; s != 16; s++) {
+        if (s != 0) {
+            CHECK(ring.insert(s) != nullptr);
+        }
+    }
+    CHECK_EQ(ring.size(), 31u);
+    CHECK(!ring.contains(0));
+    CHECK(ring.contains(0xFFFFFFFFu));
+    CHECK(ring.contains(1));
+    CHECK_EQ(ring.releaseUpTo(3), 19u);
+    CHECK_EQ(ring.baseSequence(), 4u);
+    std::vector<uint32_t> seqs = sequences(ring);
+    CHECK_EQ(seqs.size(), 12u);
+    CHECK(seqs.front() == 4 && seqs.back() == 15);
+}
+
+} // namespace
+
+int main() {
+    testInsertFindErase();
+    testReleaseUpTo();
+    testGrowKeepsTimers();
+    testWrap();
+    std::printf("pending_ring_test passed\n");
+    return 0;
+}
@@ -0,0 +1,156 @@
+// DedupWindow单元测试：去重、乱序到达、窗口滑动、序列号回绕和SACK区间生成
+#include <vector>
+#include "SequenceWindow.h"
+#include "TestCheck.h"
+
+namespace {
+
+// 新连接的第一批消息乱序到达：先到的不能成为水位，早发出的消息晚到时仍是新消息
+void testOutOfOrderFirstArrival() {
+    DedupWindow w;
+    CHECK(!w.initialized());
+    CHECK(w.accept(3));
+    CHECK(w.initialized());
+    CHECK_EQ(w.deliveredUpTo(), 0u);
+    CHECK(w.hasGaps());
+    CHECK(w.accept(1));
+    CHECK_EQ(w.deliveredUpTo(), 1u);
+    CHECK(w.accept(2));
+    CHECK_EQ(w.deliveredUpTo(), 3u);
+    CHECK(!w.hasGaps());
+    CHECK(!w.accept(1));
+    CHECK(!w.accept(2));
+    CHECK(!w.accept(3));
+}
+
+// 会话换了序列号空间时从对端告知的发送起点开始
+void testResetToBase() {
+    DedupWindow w;
+    w.reset(500);
+    CHECK(!w.accept(500));
+    CHECK(w.accept(502));
+    CHECK(w.accept(501));
+    CHECK_EQ(w.deliveredUpTo(), 502u);
+}
+
+void testDuplicates() {
+    DedupWindow w;
+    for (uint32_t s = 1; s <= 100; s++) {
+        CHECK(w.accept(s));
+        CHECK(!w.accept(s));
+    }
+    CHECK_EQ(w.deliveredUpTo(), 100u);
+    CHECK(w.accept(150));
+    CHECK(!w.accept(150));
+    CHECK(w.contains(150));
+    CHECK(!w.contains(149));
+    CHECK(w.contains(100));
+}
+
+// 超出窗口右边界时整体前移，移出窗口的空洞视为已收到
+void testSlide() {
+    DedupWindow w;
+    CHECK(w.accept(1));
+    CHECK(w.accept(1 + DedupWindow::WINDOW_BITS + 10));
+    CHECK_EQ(w.deliveredUpTo(), 11u);
+    CHECK(!w.accept(5));
+    CHECK(w.accept(12));
+    CHECK_EQ(w.deliveredUpTo(), 12u);
+}
+
+// 序列号跨过2^32回绕：发送端跳过0，水位越过0时不留空洞，也不会停在0上
+void testWrap() {
+    DedupWindow w;
+    w.reset(0xFFFFFFF0u);
+    for (uint32_t s = 0xFFFFFFF1u; s != 20; s++) {
+        if (s == 0) {
+            continue;
+        }
+        CHECK(w.accept(s));
+        CHECK_EQ(w.deliveredUpTo(), s);
+    }
+    CHECK(!w.hasGaps());
+    CHECK(!w.accept(0));
+    CHECK(w.contains(0));
+    CHECK(!w.accept(0xFFFFFFFFu));
+
+    // 回绕附近乱序到达
+    DedupWindow v;
+    v.reset(0xFFFFFFFDu);
+    CHECK(v.accept(2));
+    CHECK(v.accept(1));
+    CHECK(v.accept(0xFFFFFFFFu));
+    CHECK_EQ(v.deliveredUpTo(), 0xFFFFFFFDu);
+    CHECK(v.accept(0xFFFFFFFEu));
+    CHECK_EQ(v.deliveredUpTo(), 2u);
+    CHECK(!v.hasGaps());
+
+    // 1还没到时水位停在0之前
+    DedupWindow u;
+    u.reset(0xFFFFFFFEu);
+    CHECK(u.accept(0xFFFFFFFFu));
+    CHECK_EQ(u.deliveredUpTo(), 0xFFFFFFFFu);
+    CHECK(!u.hasGaps());
+    CHECK(u.accept(1));
+    CHECK_EQ(u.deliveredUpTo(), 1u);
+}
+
+std::vector<SeqRange> ranges(const DedupWindow& w, size_t maxRanges) {
+    std::vector<SeqRange> out(maxRanges);
+    out.resize(w.receivedRanges(out.data(), maxRanges));
+    return out;
+}
+
+// SACK区间：水位之上已收到的连续区间，跨越位图字边界，数量受maxRanges限制
+void testReceivedRanges() {
+    DedupWindow w;
+    CHECK(ranges(w, 16).empty());
+    CHECK(w.accept(1));
+    CHECK(ranges(w, 16).empty());
+
+    // 水位1，已收到[3,5) [60,70) [128,129) [1025,1026)
+    CHECK(w.accept(3));
+    CHECK(w.accept(4));
+    for (uint32_t s = 60; s < 70; s++) {
+        CHECK(w.accept(s));
+    }
+    CHECK(w.accept(128));
+    CHECK(w.accept(1025));
+    std::vector<SeqRange> r = ranges(w, 16);
+    CHECK_EQ(r.size(), 4u);
+    CHECK(r[0].begin == 3 && r[0].end == 5);
+    CHECK(r[1].begin == 60 && r[1].end == 70);
+    CHECK(r[2].begin == 128 && r[2].end == 129);
+    CHECK(r[3].begin == 1025 && r[3].end == 1026);
+
+    r = ranges(w, 2);
+    CHECK_EQ(r.size(), 2u);
+    CHECK(r[1].begin == 60 && r[1].end == 70);
+
+    // 填上空洞后区间并入水位
+    CHECK(w.accept(2));
+    CHECK_EQ(w.deliveredUpTo(), 4u);
+    r = ranges(w, 16);
+    CHECK_EQ(r.size(), 3u);
+    CHECK(r[0].begin == 60);
+
+    // 区间延伸到窗口右边界
+    DedupWindow e;
+    CHECK(e.accept(DedupWindow::WINDOW_BITS));
+    r = ranges(e, 16);
+    CHECK_EQ(r.size(), 1u);
+    CHECK(r[0].begin == DedupWindow::WINDOW_BITS && r[0].end == DedupWindow::WINDOW_BITS + 1);
+}
+
+} // namespace
+
+int main() {
+    testOutOfOrderFirstArrival();
+    testResetToBase();
+    testDuplicates();
+    testSlide();
+    testWrap();
+    testReceivedRanges();
+    std::printf("sequence_window_test passed\n");
+    return 0;
+}
@@ -0,0 +1,135 @@
+// ThreadPool与WorkStealingPool吞吐对比
+// 用法: threadpool_bench [worker线程数] [提交线程数] [每个提交线程的任务数]
+//
+// 三种负载：
+//   external  外部线程提交空任务（对应IO线程把消息投递给业务线程池）
+//   nested    每个任务在worker内部再提交子任务（对应Strand在worker中重新排队）
+//   strand    外部线程按连接投递到Strand，检查同一Strand内的顺序
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "ThreadPool.h"
+#include "WorkStealingPool.h"
+using namespace std;
+
+namespace {
+
+void waitFor(const atomic<long>& counter, long expected) {
+    while (counter.load(memory_order_acquire) < expected) {
+        this_thread::yield();
+    }
+}
+
+void report(const char* pool, const char* workload, long tasks, chrono::steady_clock::time_point start) {
+    double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << pool << "\t" << workload << "\t" << tasks << " tasks\t" << sec * 1000 << " ms\t"
+         << static_cast<long>(tasks / sec) << " tasks/s" << endl;
+}
+
+template <typename Pool>
+void benchExternal(const char* name, size_t workers, int producers, long perProducer) {
+    Pool pool(workers);
+    pool.start();
+    atomic<long> done(0);
+    auto start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&pool, &done, perProducer]() {
+            for (long i = 0; i < perProducer; ++i) {
+                pool.addTask([&done]() { done.fetch_add(1, memory_order_release); });
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    waitFor(done, producers * perProducer);
+    report(name, "external", producers * perProducer, start);
+    pool.stop();
+}
+
+// 每个根任务展开成一棵深度为depth的二叉树
+template <typename Pool>
+void spawn(Pool* pool, atomic<long>* done, int depth) {
+    done->fetch_add(1, memory_order_release);
+    if (depth == 0) return;
+    pool->addTask([pool, done, depth]() { spawn(pool, done, depth - 1); });
+    pool->addTask([pool, done, depth]() { spawn(pool, done, depth - 1); });
+}
+
+template <typename Pool>
+void benchNested(const char* name, size_t workers, int roots, int depth) {
+    Pool pool(workers);
+    pool.start();
+    atomic<long> done(0);
+    long expected = static_cast<long>(roots) * ((1L << (depth + 1)) - 1);
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < roots; ++r) {
+        Pool* p = &pool;
+        atomic<long>* d = &done;
+        pool.addTask([p, d, depth]() { spawn(p, d, depth); });
+    }
+    waitFor(done, expected);
+    report(name, "nested", expected, start);
+    pool.stop();
+}
+
+template <typename Pool>
+void benchStrand(const char* name, size_t workers, int producers, long perProducer) {
+    Pool pool(workers);
+    pool.start();
+    const int strandCount = 64;
+    vector<shared_ptr<BasicStrand<Pool>>> strands;
+    vector<long> lastSeen(strandCount, -1);
+    for (int s = 0; s < strandCount; ++s) {
+        strands.push_back(make_shared<BasicStrand<Pool>>(&pool));
+    }
+    atomic<long> done(0);
+    atomic<long> outOfOrder(0);
+    auto start = chrono::steady_clock::now();
+    vector<thread> threads;
+    // 每个提交线程只投递到属于自己的Strand，保证同一Strand内的投递顺序确定
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (long i = 0; i < perProducer; ++i) {
+                int s = p + producers * static_cast<int>(i % (strandCount / producers));
+                strands[s]->post([&, s, i]() {
+                    if (lastSeen[s] >= i) outOfOrder.fetch_add(1);
+                    lastSeen[s] = i;
+                    done.fetch_add(1, memory_order_release);
+                });
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    waitFor(done, producers * perProducer);
+    report(name, "strand", producers * perProducer, start);
+    if (outOfOrder.load() != 0) {
+        cout << "ERROR: " << outOfOrder.load() << " tasks ran out of order" << endl;
+    }
+    pool.stop();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t workers = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : thread::hardware_concurrency();
+    int producers = argc > 2 ? atoi(argv[2]) : 4;
+    long perProducer = argc > 3 ? atol(argv[3]) : 200000;
+    if (workers == 0) workers = 1;
+    if (producers <= 0 || producers > 64) producers = 4;
+
+    cout << "workers: " << workers << ", producers: " << producers << ", tasks per producer: " << perProducer << endl;
+
+    benchExternal<ThreadPool>("ThreadPool", workers, producers, perProducer);
+    benchExternal<WorkStealingPool>("WorkStealing", workers, producers, perProducer);
+
+    benchNested<ThreadPool>("ThreadPool", workers, 64, 12);
+    benchNested<WorkStealingPool>("WorkStealing", workers, 64, 12);
+
+    benchStrand<ThreadPool>("ThreadPool", workers, producers, perProducer);
+    benchStrand<WorkStealingPool>("WorkStealing", workers, producers, perProducer);
+    return 0;
+}
@@ -0,0 +1,135 @@
+// TimingWheel单元测试：各层边界上的降级、空闲后重新同步、跳过空区间、与逐个检查的参考实现对比
+#include <cstdlib>
+#include <map>
+#include <vector>
+#include "TimingWheel.h"
+#include "TestCheck.h"
+
+namespace {
+
+struct Timer : public TimerNode {
+    uint64_t firedAt = 0;
+};
+
+// 每次推进一个tick，定时器必须恰好在到期的tick触发
+void testCascadesStepByStep() {
+    const uint64_t expires[] = {0, 1, 255, 256, 257, 511, 512, 16383, 16384, 16385, 20000};
+    const size_t count = sizeof(expires) / sizeof(expires[0]);
+    TimingWheel wheel;
+    std::vector<Timer> timers(count);
+    for (size_t i = 0; i < count; i++) {
+        wheel.add(&timers[i], expires[i]);
+    }
+    for (uint64_t now = 0; now <= 20000; now++) {
+        wheel.advance(now, [now](TimerNode* node) { static_cast<Timer*>(node)->firedAt = now; });
+    }
+    CHECK(wheel.empty());
+    for (size_t i = 0; i < count; i++) {
+        CHECK_EQ(timers[i].firedAt, expires[i]);
+    }
+}
+
+// 高层的定时器：推进到到期前一个tick不触发，到期时触发
+void testCascadesHighLevels() {
+    const uint64_t expires[] = {1ULL << 14, (1ULL << 20) - 1, 1ULL << 20, (1ULL << 20) + 77, TimingWheel::MAX_TICKS};
+    for (size_t i = 0; i < sizeof(expires) / sizeof(expires[0]); i++) {
+        TimingWheel wheel;
+        Timer timer;
+        wheel.add(&timer, expires[i]);
+        int fired = 0;
+        wheel.advance(expires[i] - 1, [&fired](TimerNode*) { fired++; });
+        CHECK_EQ(fired, 0);
+        CHECK(timer.scheduled());
+        wheel.advance(expires[i], [&fired](TimerNode*) { fired++; });
+        CHECK_EQ(fired, 1);
+        CHECK(wheel.empty());
+    }
+}
+
+// 空闲很久之后添加定时器：先同步到调用方的当前时间，定时器不会立即到期，也不会晚到期
+void testIdleResync() {
+    TimingWheel wheel;
+    Timer first;
+    wheel.add(&first, 5);
+    wheel.advance(10, [](TimerNode*) {});
+    CHECK(wheel.empty());
+
+    const uint64_t now = 100000000ULL;
+    Timer timer;
+    wheel.add(&timer, now + 5, now);
+    CHECK_EQ(wheel.currentTick(), now);
+    uint64_t hint = 0;
+    CHECK(wheel.nextExpiryHint(hint));
+    CHECK(hint <= now + 5);
+    int fired = 0;
+    wheel.advance(now + 4, [&fired](TimerNode*) { fired++; });
+    CHECK_EQ(fired, 0);
+    wheel.advance(now + 5, [&fired](TimerNode*) { fired++; });
+    CHECK_EQ(fired, 1);
+
+    // 时间轮不空时不能回拨：nowTick早于当前时间时忽略
+    Timer later;
+    Timer pinned;
+    wheel.add(&pinned, now + 1000);
+    wheel.add(&later, now + 20, now - 50);
+    CHECK_EQ(wheel.currentTick(), now + 6);
+    wheel.advance(now + 20, [&fired](TimerNode*) { fired++; });
+    CHECK_EQ(fired, 2);
+}
+
+// 远处只有一个定时器时，推进直接跳到它所在的位置
+void testSkipEmptyStretch() {
+    TimingWheel wheel;
+    Timer timer;
+    const uint64_t expire = (1ULL << 25) + 12345;
+    wheel.add(&timer, expire);
+    int fired = 0;
+    wheel.advance(expire + 100, [&fired](TimerNode*) { fired++; });
+    CHECK_EQ(fired, 1);
+    CHECK_EQ(wheel.currentTick(), expire + 101);
+}
+
+// 随机添加、取消、推进，与逐个检查到期时间的参考实现对比
+void testAgainstReference() {
+    std::srand(12345);
+    for (int round = 0; round < 50; round++) {
+        TimingWheel wheel(static_cast<uint64_t>(std::rand() % 100000));
+        std::vector<Timer> timers(200);
+        std::map<TimerNode*, uint64_t> reference;
+        uint64_t now = wheel.currentTick();
+        for (size_t i = 0; i < timers.size(); i++) {
+            uint64_t delay = std::rand() % 3 == 0 ? std::rand() % (1 << 22) : std::rand() % 2000;
+            wheel.add(&timers[i], now + delay);
+            reference[&timers[i]] = now + delay;
+        }
+        for (size_t i = 0; i < timers.size(); i += 7) {
+            timers[i].cancel();
+            reference.erase(&timers[i]);
+        }
+        while (!reference.empty()) {
+            now += 1 + (std::rand() % 5 == 0 ? std::rand() % 300000 : std::rand() % 50);
+            wheel.advance(now, [&reference, now](TimerNode* node) {
+                std::map<TimerNode*, uint64_t>::iterator it = reference.find(node);
+                CHECK(it != reference.end());
+                CHECK(it->second <= now);
+                reference.erase(it);
+            });
+            for (std::map<TimerNode*, uint64_t>::iterator it = reference.begin(); it != reference.end(); ++it) {
+                CHECK(it->second > now);
+            }
+        }
+        CHECK(wheel.empty());
+    }
+}
+
+} // namespace
+
+int main() {
+    testCascadesStepByStep();
+    testCascadesHighLevels();
+    testIdleResync();
+    testSkipEmptyStretch();
+    testAgainstReference();
+    std::printf("timing_wheel_test passed\n");
+    return 0;
+}